@@ -30,7 +30,23 @@ HEADERS += \
     include/SnapManager.h \
     include/Line.h \
     include/DxfHandler.h \
-    include/GhostTracker.h
+    include/GhostTracker.h \
+    include/LineRenderer.h \
+    include/SpatialHash.h \
+    include/IntersectionIndex.h \
+    include/Document.h \
+    include/DxfLoader.h \
+    include/Selection.h \
+    include/RTree.h \
+    include/LineStore.h \
+    include/SlotMap.h \
+    include/SelectionSet.h \
+    include/LineLod.h \
+    include/TextAtlas.h \
+    include/DimensionRenderer.h \
+    include/SnapWorker.h \
+    include/GeometryKernels.h \
+    include/Topology.h
 
 SOURCES += \
     src/main.cpp \
@@ -38,7 +54,23 @@ SOURCES += \
     src/MainWindow.cpp \
     src/SnapManager.cpp \
     src/DxfHandler.cpp \
-    src/GhostTracker.cpp
+    src/GhostTracker.cpp \
+    src/LineRenderer.cpp \
+    src/SpatialHash.cpp \
+    src/IntersectionIndex.cpp \
+    src/Document.cpp \
+    src/DxfLoader.cpp \
+    src/Selection.cpp \
+    src/RTree.cpp \
+    src/LineStore.cpp \
+    src/SlotMap.cpp \
+    src/SelectionSet.cpp \
+    src/LineLod.cpp \
+    src/TextAtlas.cpp \
+    src/DimensionRenderer.cpp \
+    src/SnapWorker.cpp \
+    src/GeometryKernels.cpp \
+    src/Topology.cpp
 
 RC_ICONS = assets/appicon.ico
 
@@ -0,0 +1,56 @@
+QT       += core gui opengl
+CONFIG   += c++17 console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+TARGET = OGLBench
+
+# Benchmarks for the drawing core; run with --help for options.
+# Rendering uses an offscreen surface, so no display is needed
+# (QT_QPA_PLATFORM defaults to "offscreen").
+
+DESTDIR = $$PWD/../bin
+OBJECTS_DIR = $$PWD/../build/bench/obj
+MOC_DIR = $$PWD/../build/bench/moc
+
+# Include paths
+INCLUDEPATH += $$PWD/../include
+QT_INCLUDE_PATH = ../../../Qt/6.8.1/mingw_64
+INCLUDEPATH += $$QT_INCLUDE_PATH/include
+INCLUDEPATH += $$QT_INCLUDE_PATH/include/QtCore
+INCLUDEPATH += $$QT_INCLUDE_PATH/include/QtGui
+INCLUDEPATH += $$QT_INCLUDE_PATH/include/QtOpenGL
+
+# Library paths
+win32: LIBS += -L$$QT_INCLUDE_PATH/lib -lopengl32
+unix: LIBS += -lGL
+
+HEADERS += \
+    ../include/SnapManager.h \
+    ../include/Line.h \
+    ../include/DxfHandler.h \
+    ../include/LineRenderer.h \
+    ../include/SpatialHash.h \
+    ../include/IntersectionIndex.h \
+    ../include/Document.h \
+    ../include/Selection.h \
+    ../include/RTree.h \
+    ../include/LineStore.h \
+    ../include/SlotMap.h \
+    ../include/LineLod.h \
+    ../include/GeometryKernels.h
+
+SOURCES += \
+    main.cpp \
+    ../src/SnapManager.cpp \
+    ../src/DxfHandler.cpp \
+    ../src/LineRenderer.cpp \
+    ../src/SpatialHash.cpp \
+    ../src/IntersectionIndex.cpp \
+    ../src/Document.cpp \
+    ../src/Selection.cpp \
+    ../src/RTree.cpp \
+    ../src/LineStore.cpp \
+    ../src/SlotMap.cpp \
+    ../src/LineLod.cpp \
+    ../src/GeometryKernels.cpp
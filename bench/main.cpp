@@ -0,0 +1,442 @@
+#include <QGuiApplication>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+#include <QSurfaceFormat>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QElapsedTimer>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <GL/gl.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+#include "SnapManager.h"
+#include "Document.h"
+#include "DxfHandler.h"
+#include "GeometryKernels.h"
+#include "LineRenderer.h"
+#include "Selection.h"
+
+namespace {
+
+struct Options {
+    std::vector<size_t> sizes{1000, 10000, 100000, 1000000, 10000000};
+    QString output;          // Empty writes the report to stdout
+    int maxIterations = 1000;
+    qint64 minTimeNs = 300000000;  // Keep repeating cheap cases for this long
+};
+
+// A drawing with constant density: mostly short segments in random
+// directions plus one long segment in a hundred, spread over a square that
+// grows with the line count. Snap and selection cost then reflects the data
+// structures rather than how crowded the drawing is.
+LineStore makeDrawing(size_t count, float& extent)
+{
+    extent = std::sqrt(static_cast<float>(count)) * 50.0f;
+
+    std::mt19937 rng(12345);
+    std::uniform_real_distribution<float> position(0.0f, extent);
+    std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+    std::uniform_real_distribution<float> shortLength(5.0f, 100.0f);
+    std::uniform_real_distribution<float> longLength(extent * 0.05f, extent * 0.2f);
+    const QColor colors[] = {Qt::white, Qt::red, Qt::green, Qt::cyan, Qt::yellow};
+
+    LineStore lines;
+    lines.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        QVector2D start(position(rng), position(rng));
+        float length = (i % 100 == 0) ? longLength(rng) : shortLength(rng);
+        float a = angle(rng);
+        QVector2D end = start + QVector2D(std::cos(a), std::sin(a)) * length;
+        lines.push_back(Line(start, end, colors[i % 5]));
+    }
+    return lines;
+}
+
+// Random sample of roughly 'fraction' of the indices, ascending
+std::vector<int> sampleIndices(size_t count, double fraction, std::mt19937& rng)
+{
+    std::vector<int> indices;
+    std::bernoulli_distribution pick(fraction);
+    for (size_t i = 0; i < count; ++i) {
+        if (pick(rng)) indices.push_back(static_cast<int>(i));
+    }
+    if (indices.empty() && count > 0) indices.push_back(0);
+    return indices;
+}
+
+class Report
+{
+public:
+    explicit Report(const Options& options) : options(options) {}
+
+    // Runs 'body(iteration)' until maxIterations or until minTimeNs has
+    // passed (at least once) and records the timings under 'name'
+    template <typename Body>
+    void measure(const char* name, size_t lineCount, Body body, int maxIterations = -1,
+                 const QJsonObject& extra = QJsonObject())
+    {
+        if (maxIterations < 0) maxIterations = options.maxIterations;
+
+        qint64 total = 0;
+        qint64 fastest = -1;
+        int iterations = 0;
+        while (iterations < maxIterations && (iterations == 0 || total < options.minTimeNs)) {
+            QElapsedTimer timer;
+            timer.start();
+            body(iterations);
+            qint64 elapsed = timer.nsecsElapsed();
+
+            total += elapsed;
+            fastest = fastest < 0 ? elapsed : std::min(fastest, elapsed);
+            ++iterations;
+        }
+        record(name, lineCount, iterations, total, fastest, extra);
+    }
+
+    void record(const char* name, size_t lineCount, int iterations, qint64 totalNs, qint64 minNs,
+                const QJsonObject& extra = QJsonObject())
+    {
+        QJsonObject result = extra;
+        result["name"] = QString(name);
+        result["lines"] = static_cast<qint64>(lineCount);
+        result["iterations"] = iterations;
+        result["totalMs"] = totalNs / 1e6;
+        result["meanUs"] = iterations > 0 ? totalNs / 1e3 / iterations : 0.0;
+        result["minUs"] = minNs / 1e3;
+        results.append(result);
+
+        std::fprintf(stderr, "%-24s %10zu lines  %12.2f us/iter  (%d iterations)\n", name, lineCount,
+                     iterations > 0 ? totalNs / 1e3 / iterations : 0.0, iterations);
+    }
+
+    QJsonArray results;
+
+private:
+    const Options& options;
+};
+
+void benchSnapping(const LineStore& lines, float extent, Report& report)
+{
+    Document document;
+    document.setLines(lines);
+    SnapManager snapManager(5.0f, 1.0f, document);
+
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> position(0.0f, extent);
+
+    // The first query builds the grid and the crossing index
+    report.measure("snap_index_build", lines.size(), [&](int) {
+        snapManager.updateSnap(QVector2D(position(rng), position(rng)));
+    }, 1);
+
+    report.measure("snap_query", lines.size(), [&](int) {
+        snapManager.updateSnap(QVector2D(position(rng), position(rng)));
+    });
+
+    // Cursor path a few pixels per step, as mouse moves arrive; most steps
+    // reuse the cached candidates
+    std::uniform_real_distribution<float> step(-3.0f, 3.0f);
+    QVector2D cursor(extent * 0.5f, extent * 0.5f);
+    report.measure("snap_hover", lines.size(), [&](int) {
+        cursor += QVector2D(step(rng), step(rng));
+        snapManager.updateSnap(cursor);
+    });
+
+    // Only the endpoint pass compiled in; the crossing index is dropped
+    snapManager.setSnapModes(SnapManager::SnapEndpoint);
+    report.measure("snap_query_endpoint", lines.size(), [&](int) {
+        snapManager.updateSnap(QVector2D(position(rng), position(rng)));
+    });
+    snapManager.setSnapModes(SnapManager::AllSnapModes);
+    snapManager.updateSnap(QVector2D(position(rng), position(rng)));
+
+    // Edits go through the document; the next query replays them into the indices
+    report.measure("move_1pct", lines.size(), [&](int) {
+        document.moveLines(sampleIndices(document.size(), 0.01, rng), QVector2D(1.0f, -1.0f));
+        snapManager.updateSnap(QVector2D(position(rng), position(rng)));
+    }, 20);
+
+    report.measure("delete_1pct", lines.size(), [&](int) {
+        document.eraseLines(sampleIndices(document.size(), 0.01, rng));
+        snapManager.updateSnap(QVector2D(position(rng), position(rng)));
+    }, 20);
+}
+
+void benchSelection(const LineStore& lines, float extent, Report& report)
+{
+    Document document;
+    document.setLines(lines);
+    Selection selection(document);
+
+    std::mt19937 rng(2);
+    const float size = extent * 0.05f;
+    std::uniform_real_distribution<float> position(0.0f, extent - size);
+    std::vector<int> selected;
+
+    // The first query bulk-loads the R-tree
+    report.measure("select_index_build", lines.size(), [&](int) {
+        selected.clear();
+        selection.selectInRect(QRectF(0, 0, 1, 1), false, selected);
+    }, 1);
+
+    auto randomRect = [&]() {
+        float x = position(rng);
+        float y = position(rng);
+        return QRectF(QPointF(x, y), QPointF(x + size, y + size));
+    };
+
+    report.measure("select_window", lines.size(), [&](int) {
+        selected.clear();
+        selection.selectInRect(randomRect(), false, selected);
+    });
+
+    report.measure("select_crossing", lines.size(), [&](int) {
+        selected.clear();
+        selection.selectInRect(randomRect(), true, selected);
+    });
+
+    std::uniform_real_distribution<float> point(0.0f, extent);
+    report.measure("pick", lines.size(), [&](int) {
+        selection.pickLine(QVector2D(point(rng), point(rng)), 10.0f);
+    });
+}
+
+// The batched segment tests over every line, once per instruction set the
+// CPU supports
+void benchKernels(const LineStore& lines, float extent, Report& report)
+{
+    using GeometryKernels::InstructionSet;
+    const GeometryKernels::Segments segments = GeometryKernels::columns(lines);
+    const size_t count = lines.size();
+    std::vector<int> ids(count);
+    std::vector<int> next(count);
+    for (size_t i = 0; i < count; ++i) {
+        ids[i] = static_cast<int>(i);
+        next[i] = static_cast<int>((i + 1) % count);
+    }
+    std::vector<float> distances(count);
+    std::vector<unsigned char> hits(count);
+    const float center = extent * 0.5f;
+
+    for (InstructionSet set : {InstructionSet::Scalar, InstructionSet::Sse2, InstructionSet::Avx2}) {
+        GeometryKernels::setInstructionSet(set);
+        if (GeometryKernels::instructionSet() != set) continue;
+        const QJsonObject extra{{"instructionSet", QString(GeometryKernels::instructionSetName(set))}};
+
+        report.measure("kernel_distance", count, [&](int) {
+            GeometryKernels::distanceSquared(segments, ids.data(), count, center, center, distances.data());
+        }, -1, extra);
+
+        report.measure("kernel_rect", count, [&](int) {
+            GeometryKernels::overlapsRect(segments, ids.data(), count, center, center, center * 1.1f, center * 1.1f, hits.data());
+        }, -1, extra);
+
+        report.measure("kernel_intersect", count, [&](int) {
+            GeometryKernels::intersectPairs(segments, ids.data(), next.data(), count, hits.data());
+        }, -1, extra);
+    }
+    GeometryKernels::setInstructionSet(InstructionSet::Avx2);
+}
+
+void benchFileIo(const LineStore& lines, Report& report)
+{
+    const QString filename = QDir::tempPath() + QString("/oglbench_%1.dxf").arg(static_cast<qint64>(lines.size()));
+
+    report.measure("dxf_save", lines.size(), [&](int) {
+        DxfHandler::saveDxf(filename, lines);
+    }, 3);
+
+    // Throughput follows from the file size and the timings
+    const QJsonObject fileSize{{"bytes", QFile(filename).size()}};
+    LineStore loaded;
+    report.measure("dxf_load", lines.size(), [&](int) {
+        DxfHandler::loadDxf(filename, loaded);
+    }, 3, fileSize);
+
+    QFile::remove(filename);
+}
+
+void benchRendering(const LineStore& lines, float extent, Report& report)
+{
+    QOpenGLFramebufferObject framebuffer(1920, 1080);
+    framebuffer.bind();
+    glViewport(0, 0, 1920, 1080);
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    glOrtho(0, extent, 0, extent, -1, 1);
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+
+    Document document;
+    document.setLines(lines);
+    LineRenderer renderer;
+    renderer.initialize();
+
+    report.measure("render_upload", lines.size(), [&](int) {
+        renderer.invalidateAll();
+        renderer.sync(document);
+        glFinish();
+    }, 3);
+
+    report.measure("render_frame", lines.size(), [&](int) {
+        glClear(GL_COLOR_BUFFER_BIT);
+        renderer.sync(document);
+        renderer.draw();
+        glFinish();
+    }, 200);
+
+    // Zoomed in on about 1% of the drawing; only the lines in view are drawn
+    Selection culling(document);
+    std::vector<int> visible;
+    const QRectF view(extent * 0.45, extent * 0.45, extent * 0.1, extent * 0.1);
+    report.measure("render_frame_view_1pct", lines.size(), [&](int) {
+        glClear(GL_COLOR_BUFFER_BIT);
+        renderer.sync(document);
+        culling.linesInRect(view, visible);
+        renderer.draw(visible);
+        glFinish();
+    }, 200);
+
+    // Whole drawing on a 1080 pixel high target; collapses sub-pixel lines
+    // once the document is large enough for the level of detail to kick in.
+    // The first zoomed-out frame starts building it on a worker thread.
+    renderer.sync(document);
+    renderer.drawLevelOfDetail(document, extent / 1080.0f);
+    renderer.waitForLevelOfDetail();
+    report.measure("render_frame_lod", lines.size(), [&](int) {
+        glClear(GL_COLOR_BUFFER_BIT);
+        renderer.sync(document);
+        if (!renderer.drawLevelOfDetail(document, extent / 1080.0f)) {
+            renderer.draw();
+        }
+        glFinish();
+    }, 200);
+
+    std::mt19937 rng(3);
+    report.measure("render_edit_1pct", lines.size(), [&](int) {
+        document.setLinesColor(sampleIndices(document.size(), 0.01, rng), Qt::magenta);
+        glClear(GL_COLOR_BUFFER_BIT);
+        renderer.sync(document);
+        renderer.draw();
+        glFinish();
+    }, 50);
+
+    // Selection only rewrites attribute texture rows, never the vertex buffer
+    report.measure("render_select_10pct", lines.size(), [&](int) {
+        const std::vector<int> selected = sampleIndices(document.size(), 0.1, rng);
+        glClear(GL_COLOR_BUFFER_BIT);
+        renderer.sync(document);
+        renderer.setSelection(selected);
+        renderer.draw();
+        glFinish();
+    }, 50);
+
+    renderer.cleanup();
+    framebuffer.release();
+}
+
+bool parseOptions(const QStringList& arguments, Options& options)
+{
+    for (int i = 1; i < arguments.size(); ++i) {
+        const QString& argument = arguments[i];
+        bool hasValue = i + 1 < arguments.size();
+
+        if (argument == "--sizes" && hasValue) {
+            options.sizes.clear();
+            for (const QString& size : arguments[++i].split(',')) {
+                bool ok = false;
+                qint64 value = size.toLongLong(&ok);
+                if (!ok || value <= 0) return false;
+                options.sizes.push_back(static_cast<size_t>(value));
+            }
+        } else if (argument == "--output" && hasValue) {
+            options.output = arguments[++i];
+        } else if (argument == "--iterations" && hasValue) {
+            options.maxIterations = std::max(1, arguments[++i].toInt());
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    // Rendering runs on an offscreen surface, so no display is required
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QGuiApplication app(argc, argv);
+
+    Options options;
+    if (!parseOptions(app.arguments(), options)) {
+        std::fprintf(stderr, "usage: OGLBench [--sizes 1000,10000,...] [--iterations N] [--output report.json]\n");
+        return 2;
+    }
+
+    // The line renderer relies on the fixed-function matrix stack
+    QSurfaceFormat format;
+    format.setProfile(QSurfaceFormat::CompatibilityProfile);
+    QOffscreenSurface surface;
+    surface.setFormat(format);
+    surface.create();
+    QOpenGLContext context;
+    context.setFormat(format);
+    const bool hasGl = context.create() && context.makeCurrent(&surface);
+    if (!hasGl) {
+        std::fprintf(stderr, "No OpenGL context on this platform; skipping rendering\n");
+    }
+
+    Report report(options);
+    for (size_t size : options.sizes) {
+        float extent = 0.0f;
+        LineStore lines = makeDrawing(size, extent);
+
+        benchSnapping(lines, extent, report);
+        benchSelection(lines, extent, report);
+        benchKernels(lines, extent, report);
+        benchFileIo(lines, report);
+        if (hasGl) {
+            benchRendering(lines, extent, report);
+        }
+    }
+
+    QJsonObject root;
+    root["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    root["qtVersion"] = QString(qVersion());
+#ifdef QT_DEBUG
+    root["build"] = QString("debug");
+#else
+    root["build"] = QString("release");
+#endif
+    root["hardwareThreads"] = static_cast<int>(std::thread::hardware_concurrency());
+    root["glRenderer"] = hasGl ? QString(reinterpret_cast<const char*>(glGetString(GL_RENDERER))) : QString();
+    root["results"] = report.results;
+
+    const QByteArray json = QJsonDocument(root).toJson();
+    if (options.output.isEmpty()) {
+        std::fwrite(json.constData(), 1, static_cast<size_t>(json.size()), stdout);
+    } else {
+        QFile file(options.output);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            std::fprintf(stderr, "Cannot write %s\n", qPrintable(options.output));
+            return 1;
+        }
+        file.write(json);
+    }
+
+    if (hasGl) {
+        context.doneCurrent();
+    }
+    return 0;
+}
@@ -0,0 +1,52 @@
+#ifndef DIMENSIONRENDERER_H
+#define DIMENSIONRENDERER_H
+
+#include <QOpenGLFunctions>
+#include <QOpenGLBuffer>
+#include <QOpenGLShaderProgram>
+#include <QColor>
+#include <QVector2D>
+#include <vector>
+
+// Batched geometry of linear dimensions: extension lines, dimension line
+// and the two arrowheads, all as GL_LINES in one vertex buffer.
+//
+// Arrowheads keep a fixed size on screen. Their corners are stored as an
+// offset in pixels from the arrow tip, which the vertex shader scales by the
+// current world size of a pixel, so zooming changes a uniform instead of
+// rebuilding the batch. The batch only has to be rebuilt when dimensions are
+// added or removed. All calls except clear()/addDimension() must run with
+// the GL context current.
+class DimensionRenderer : protected QOpenGLFunctions
+{
+public:
+    DimensionRenderer();
+    ~DimensionRenderer();
+
+    void initialize();  // Call from initializeGL()
+    void cleanup();     // Call with the context current before it goes away
+
+    void clear();
+    void addDimension(const QVector2D& start, const QVector2D& end, float offset);
+
+    // Draws the batch with the current fixed-function matrices
+    void draw(float worldPerPixel, const QColor& color);
+
+private:
+    struct Vertex {
+        float x, y;              // World position
+        float offsetX, offsetY;  // Pixels, along the world axes
+    };
+
+    void setupAttributes();
+
+    QOpenGLBuffer vertexBuffer;
+    QOpenGLShaderProgram program;
+    bool initialized;
+
+    std::vector<Vertex> batch;
+    bool batchDirty;
+    size_t uploadedVertices;
+};
+
+#endif // DIMENSIONRENDERER_H
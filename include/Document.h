@@ -0,0 +1,81 @@
+#ifndef DOCUMENT_H
+#define DOCUMENT_H
+
+#include <QVector2D>
+#include <QColor>
+#include <QtGlobal>
+#include <deque>
+#include <utility>
+#include <vector>
+#include "Line.h"
+#include "LineStore.h"
+#include "SlotMap.h"
+
+// One recorded edit of the document.
+struct DocumentChange {
+    enum Type {
+        LinesAdded,     // 'ranges' holds the new lines
+        LinesModified,  // 'ranges' holds the edited lines
+        LinesRemoved,   // 'removed' holds ascending indices from before the removal
+        LinesReset      // Everything was replaced
+    };
+
+    Type type = LinesReset;
+    quint64 version = 0;           // Document version after this change
+    bool geometryChanged = false;  // False for colour-only edits
+    std::vector<std::pair<size_t, size_t>> ranges;  // [first, last) line indices
+    std::vector<int> removed;
+};
+
+// Owns the drawing's lines and records every edit.
+//
+// Lines are addressed by position for dense iteration; handleAt() gives a
+// stable EntityHandle for code that must hold on to a line across edits
+// that may remove others.
+//
+// Each mutation bumps version() and appends a DocumentChange to a short
+// log. Consumers (renderer, snapping, ...) keep a const reference to the
+// document plus the last version they processed, and replay only the
+// changes since then instead of copying or rescanning the lines.
+class Document
+{
+public:
+    Document();
+
+    const LineStore& lines() const { return lineData; }
+    size_t size() const { return lineData.size(); }
+    bool empty() const { return lineData.empty(); }
+    Line line(size_t index) const { return lineData.line(index); }
+
+    EntityHandle handleAt(size_t index) const { return handles.handleAt(index); }
+    int indexOf(const EntityHandle& handle) const { return handles.indexOf(handle); }  // -1 once removed
+
+    quint64 version() const { return currentVersion; }
+
+    EntityHandle addLine(const Line& line);
+    void appendLines(const LineStore& newLines);
+    void setLines(LineStore newLines);
+    void clear();
+    void moveLines(const std::vector<int>& indices, const QVector2D& delta);
+    void setLinesColor(const std::vector<int>& indices, const QColor& color);
+    // Overwrites the endpoints of the given lines (ascending) with those of
+    // newLines, in order; colours are kept
+    void replaceGeometry(const std::vector<int>& sortedIndices, const LineStore& newLines);
+    void eraseLines(const std::vector<int>& indices);  // Any order, duplicates allowed
+
+    // Collects the changes made after 'sinceVersion', oldest first. Returns
+    // false when they are no longer in the log; the caller must then resync
+    // from lines() as if everything was reset.
+    bool changesSince(quint64 sinceVersion, std::vector<const DocumentChange*>& out) const;
+
+private:
+    void record(DocumentChange change);
+    static std::vector<std::pair<size_t, size_t>> toRanges(std::vector<int> indices, size_t limit);
+
+    LineStore lineData;
+    SlotMap handles;  // Slots only for lines whose handles were asked for
+    quint64 currentVersion;
+    std::deque<DocumentChange> changeLog;
+};
+
+#endif // DOCUMENT_H
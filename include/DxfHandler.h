@@ -4,15 +4,53 @@
 #include <QTextStream>
 #include <QVector2D>
 #include <vector>
+#include <functional>
 #include "Line.h"
+#include "LineStore.h"
 #include <QColor>
+#include <QtGlobal>
+
+// Timing of the last load, for tracking parser throughput
+struct DxfLoadStats {
+    qint64 bytes = 0;
+    qint64 elapsedNs = 0;
+    size_t entities = 0;
+
+    double megabytesPerSecond() const {
+        return elapsedNs > 0 ? (bytes / (1024.0 * 1024.0)) / (elapsedNs / 1e9) : 0.0;
+    }
+};
+
+// Drawing extents from the HEADER section ($EXTMIN / $EXTMAX)
+struct DxfExtents {
+    QVector2D min;
+    QVector2D max;
+    bool valid = false;
+};
+
+// Receivers for a streamed load. Both are called on the loading thread.
+struct DxfLoadCallbacks {
+    // Called once, before the first batch, if the header has usable extents
+    std::function<void(const DxfExtents& extents)> extents;
+    // Called with each parsed batch in file order; may take the lines.
+    // Returning false cancels the load.
+    std::function<bool(LineStore& batch, qint64 bytesDone, qint64 bytesTotal)> batch;
+};
 
 class DxfHandler {
 public:
-    static bool saveDxf(const QString& filename, const std::vector<Line>& lines);
-    static bool loadDxf(const QString& filename, std::vector<Line>& lines);
+    // Coordinates are written with 'precision' fixed decimals, or in the
+    // shortest form that reads back exactly when it is negative
+    static bool saveDxf(const QString& filename, const LineStore& lines, int precision = 6);
+    static bool loadDxf(const QString& filename, LineStore& lines, DxfLoadStats* stats = nullptr);
+
+    // Streams the file's lines in batches as they are parsed. Returns false
+    // if the file cannot be read or the load was cancelled.
+    static bool loadDxf(const QString& filename, const DxfLoadCallbacks& callbacks, DxfLoadStats* stats = nullptr);
 
 private:
+    // Parses the LINE entities in [data, data + size); must start on a group code
+    static void parseLines(const char* data, size_t size, LineStore& lines);
     static int qColorToAcadColor(const QColor& color);
     static QColor acadColorToQColor(int colorNumber);
 };
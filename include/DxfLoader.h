@@ -0,0 +1,47 @@
+#ifndef DXFLOADER_H
+#define DXFLOADER_H
+
+#include <QObject>
+#include <QString>
+#include <QVector2D>
+#include <atomic>
+#include <vector>
+#include "LineStore.h"
+#include "DxfHandler.h"
+
+// Runs a streamed DxfHandler::loadDxf on whichever thread it lives in and
+// reports back through queued signals.
+//
+// Move it to a worker QThread and connect QThread::started to run(). The
+// receiver gets the header extents first (when the file has them), then the
+// lines batch by batch in file order, and finally finished().
+class DxfLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DxfLoader(const QString& filename, QObject* parent = nullptr);
+
+    const QString& fileName() const { return filename; }
+
+    // Thread-safe; the load stops after the batch being parsed
+    void cancel() { cancelRequested = true; }
+
+public slots:
+    void run();
+
+signals:
+    void extentsFound(const QVector2D& min, const QVector2D& max);
+    void batchLoaded(const LineStore& lines);
+    void progress(int percent);
+    void finished(bool success, bool cancelled, const DxfLoadStats& stats);
+
+private:
+    QString filename;
+    std::atomic<bool> cancelRequested;
+};
+
+Q_DECLARE_METATYPE(LineStore)
+Q_DECLARE_METATYPE(DxfLoadStats)
+
+#endif // DXFLOADER_H
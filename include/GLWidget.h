@@ -11,12 +11,22 @@
 #include <QPushButton>
 #include <QToolButton>  // Add QToolButton include
 #include <QTimer>
-#include <QDateTime>  // Add QDateTime include
+#include <QElapsedTimer>
 #include "Line.h"
 #include "DxfHandler.h"
 #include "GhostTracker.h"
-
-class SnapManager;  // Forward declare SnapManager
+#include "Document.h"
+#include "DimensionRenderer.h"
+#include "LineRenderer.h"
+#include "Selection.h"
+#include "SelectionSet.h"
+#include "SnapWorker.h"
+#include "TextAtlas.h"
+#include "Topology.h"
+
+class QOpenGLFramebufferObject;
+class QThread;
+class DxfLoader;
 
 class GLWidget : public QOpenGLWidget, protected QOpenGLFunctions
 {
@@ -38,7 +48,7 @@ public:
     void moveSelectedObject(const QVector2D& delta);
 
     // Getter for selected objects
-    const std::vector<int>& getSelectedObjects() const { return selectedObjectIndices; }
+    const std::vector<int>& getSelectedObjects() const { return selectionSet.indices(); }
 
     // Drawing modes
     enum DrawMode {
@@ -60,8 +70,22 @@ public:
 
     void zoomAll();  // Ensure zoomAll is declared as public
 
+    // Object snaps in effect, as SnapManager::SnapMode flags
+    void setSnapModes(unsigned modes);
+    unsigned snapModes() const { return activeSnapModes; }
+
+    // Moves the endpoints of drawn and loaded lines onto existing ones
+    // within Topology's tolerance, so connected lines share exact vertices
+    void setWeldEndpoints(bool enabled);
+    bool weldsEndpoints() const { return weldEndpoints; }
+
     bool saveDxf(const QString& filename);
+
+    // Starts loading in the background; lines appear as they are parsed,
+    // replacing the current drawing once the first of them arrive.
+    // Returns false if the file cannot be opened.
     bool loadDxf(const QString& filename);
+    bool isLoading() const { return dxfLoader != nullptr; }
 
     void resetAll();  // Add this new method
 
@@ -109,6 +133,8 @@ private:
         float measurement;
         QString text;
         float offset;  // Add offset for dimension line position
+        QVector2D labelAnchor;  // Middle of the dimension line
+        TextLayout label;       // 'text' laid out for labelAtlas
     };
 
     // Drawing state
@@ -121,17 +147,78 @@ private:
     QVector2D firstPoint;
     QVector2D currentStart;
     QVector2D currentEnd;  // Moved before currentMode
-    std::vector<Line> lines;
+    Document document;     // All edits go through here so consumers can track them
     DrawMode currentMode;  // Single declaration here
 
+    // Picking and rectangle selection; indexes the document's lines
+    Selection selection{document};
+
+    // Shared endpoints and their lines; built on first use and dropped
+    // again while welding is off
+    Topology topology{document};
+    bool weldEndpoints = false;
+
+    // Retained GPU copy of the document; syncs from its change log
+    LineRenderer lineRenderer;
+    std::vector<int> visibleLines;  // Culling scratch, refilled per scene render
+
+    // Offscreen image of the committed scene (lines with their selection and
+    // hover highlight). It is re-rendered only when the document, selection,
+    // hover or view changes; cursor-driven overlays are drawn on top of it
+    // every frame.
+    QOpenGLFramebufferObject* sceneCache = nullptr;
+    bool sceneCacheDirty = true;
+    QVector2D sceneCachePan;
+    float sceneCacheZoom = 0.0f;
+    quint64 sceneCacheVersion = 0;
+    void invalidateScene() { sceneCacheDirty = true; }
+    bool updateSceneCache();
+    void drawCommittedScene();
+    void drawLinesImmediate(const std::vector<int>& indices, int hovered);
+    void drawHoveredLine();
+
     std::vector<Dimension> dimensions;
-    void drawDimension(const Dimension& dim);
     void addDimension(const QVector2D& start, const QVector2D& end, float offset);  // Updated signature
 
-    // Modify the SnapManager pointer to reflect the updated constructor if needed
-    SnapManager* snapManager;
-
-    void renderText(float x, float y, const QString& text);  // Add renderText declaration
+    // Snapping runs on its own thread. Cursor moves post latest-wins
+    // requests and use the newest answer delivered so far ('currentSnap');
+    // clicks wait for the exact answer at the click point.
+    SnapWorker* snapWorker = nullptr;
+    QThread* snapThread = nullptr;
+    SnapResult currentSnap;
+    QVector2D cursorWorld;  // Last cursor position, re-applied when a snap arrives
+    unsigned activeSnapModes = SnapManager::AllSnapModes;
+    SnapQuery snapQuery(const QVector2D& worldPos) const;
+    void onSnapFound(const SnapResult& result);
+    void snapExactly(const QVector2D& worldPos);
+    void clearSnap();
+    void updateCursor(const QVector2D& worldPos);
+
+    // Background DXF load; 'loadGeneration' tells the current load's queued
+    // signals apart from those of a load that was already replaced
+    DxfLoader* dxfLoader = nullptr;
+    QThread* dxfLoadThread = nullptr;
+    quint64 loadGeneration = 0;
+    int loadPercent = 0;
+    bool loadFramed = false;
+    bool loadReplaced = false;    // The previous drawing has been cleared
+    bool loadHasExtents = false;  // Header extents, applied once it is
+    QVector2D loadMin;
+    QVector2D loadMax;
+    void stopLoading();
+    void replaceDrawing();
+    void onDxfExtents(const QVector2D& min, const QVector2D& max);
+    void onDxfBatch(const LineStore& batch);
+    void onDxfProgress(int percent);
+    void onDxfFinished(bool success, bool cancelled, const DxfLoadStats& stats);
+    void zoomToBounds(float minX, float minY, float maxX, float maxY);
+
+    // Dimension geometry and text, each drawn as one cached batch that is
+    // rebuilt only when dimensions are added or cleared
+    DimensionRenderer dimensionRenderer;
+    TextAtlas labelAtlas;
+    bool dimensionsDirty = true;
+    void drawDimensions();
 
     // View state
     QVector2D pan;
@@ -163,7 +250,8 @@ private:
 
     // Selection state
     bool objectSelected;
-    int selectedObjectIndex;  // Index of the selected line in 'lines' vector
+    EntityHandle selectedObject;  // Primary selected line; stays valid while others are removed
+    EntityHandle hoveredObject;   // Line under the cursor, highlighted by the renderer
 
     // Move operation state
     bool isMoving;
@@ -176,11 +264,14 @@ private:
     QPoint selectionEndPos;      // Declare selection end position
     QRect selectionRect;         // Declare selection rectangle
 
-    // List of selected object indices
-    std::vector<int> selectedObjectIndices;
+    // Selected line indices
+    SelectionSet selectionSet;
 
-    // Method to perform rectangle selection
-    void performRectangleSelection(const QRect& rect);
+    // Method to perform rectangle selection; Shift adds to the current
+    // selection and Ctrl removes from it
+    void performRectangleSelection(const QRect& rect, Qt::KeyboardModifiers modifiers = Qt::NoModifier);
+    void invertSelection();
+    void selectConnected();  // Adds the lines joined to the selection through shared endpoints
 
     // Add the following declarations for two-step move
     bool isAwaitingMoveFinalPoint; // Indicates if waiting for the final point
@@ -206,10 +297,6 @@ private:
     // bool isDragging;  // Track mouse dragging state
     // bool isCrossingSelection;  // Add this member variable
 
-    // Add helper function for line intersection
-    bool linesIntersect(const QVector2D& p1, const QVector2D& p2,
-                       const QVector2D& q1, const QVector2D& q2) const;
-
     QString modeToString() const;  // Add helper function
 
     // Tool button pointers
@@ -230,11 +317,11 @@ private:
     struct SnapHistory {
         QVector2D point;
         QVector2D direction;  // Store direction for perpendicular calculations
-        float timestamp;
+        qint64 timestamp;  // overlayTime() when recorded
         bool isActive;
     };
 
-    SnapHistory lastSnap = {QVector2D(0,0), QVector2D(0,0), 0.0f, false};
+    SnapHistory lastSnap = {QVector2D(0,0), QVector2D(0,0), 0, false};
     QVector2D tempConstructPoint;  // Store construction/perpendicular point
     bool hasTempConstructPoint = false;
     float snapHistoryTimeout = 2.0f;  // Seconds to keep snap history
@@ -243,9 +330,16 @@ private:
     void clearSnapHistory();
     QVector2D calculatePerpendicularPoint(const QVector2D& base, const QVector2D& ref, const QVector2D& dir) const;
     QVector2D calculateParallelPoint(const QVector2D& base, const QVector2D& ref, const QVector2D& dir) const;
-    
-    // Timer for managing snap history
-    QTimer* snapHistoryTimer;
+
+    // Snap history, track points and tracking points expire after a few
+    // seconds. A single-shot timer is armed for the earliest expiry, on a
+    // monotonic clock, so an idle window gets no wakeups at all.
+    QElapsedTimer overlayClock;
+    QTimer* expiryTimer = nullptr;
+    qint64 armedDeadline = 0;
+    qint64 overlayTime() const { return overlayClock.elapsed(); }  // Milliseconds
+    void scheduleExpiry();
+    void expireOverlays();
 
     // Track point system - consolidated declarations
     struct TrackPoint {
@@ -271,7 +365,6 @@ private:
     bool hasActiveTracking = false;
     static constexpr float trackTimeout = 2.0f;
     static constexpr float trackSnapThreshold = 10.0f;
-    QTimer* trackTimer = nullptr;
 
     // Track point methods
     void setTrackPoint(const QVector2D& point, const QVector2D& dir);
@@ -279,7 +372,6 @@ private:
     void drawTrackPoint() const;
     QVector2D getConstructionPoint(const QVector2D& currentPos) const;
     void addTrackPoint(const QVector2D& point, const QVector2D& dir, TrackPoint::Type type);
-    void updateTrackPoints();
     void drawTrackPoints() const;
     void updateTrackingPoint(const QVector2D& point);
     void clearTrackingPoints();
@@ -0,0 +1,65 @@
+#ifndef GEOMETRYKERNELS_H
+#define GEOMETRYKERNELS_H
+
+#include <cstddef>
+#include "LineStore.h"
+
+// Batched segment tests over LineStore's coordinate columns.
+//
+// Each kernel takes a list of line ids (the candidates a grid or R-tree
+// query returned), gathers their endpoints and writes one result per id.
+// Besides the scalar loop there are SSE2 and AVX2 versions; the widest one
+// the CPU supports is picked on first use, so the build needs no special
+// compiler flags. All versions evaluate the same expressions in the same
+// order and give bit-identical results.
+namespace GeometryKernels {
+
+enum class InstructionSet {
+    Scalar,
+    Sse2,
+    Avx2
+};
+
+InstructionSet instructionSet();
+const char* instructionSetName(InstructionSet set);
+
+// Restricts the kernels to 'set' (or the best supported one below it);
+// lets benchmarks and tests compare the versions
+void setInstructionSet(InstructionSet set);
+
+struct Segments {
+    const float* x0;
+    const float* y0;
+    const float* x1;
+    const float* y1;
+};
+
+inline Segments columns(const LineStore& lines)
+{
+    return {lines.x0Data(), lines.y0Data(), lines.x1Data(), lines.y1Data()};
+}
+
+// Squared distance from (px, py) to each segment; NaN for zero-length ones
+void distanceSquared(const Segments& segments, const int* ids, size_t count, float px, float py, float* out);
+
+// Projection of (px, py) onto each segment's line: the parameter along the
+// segment, NaN when its squared length is at most minLengthSquared, and the
+// point at that parameter clamped to the segment
+void project(const Segments& segments, const int* ids, size_t count, float px, float py,
+             float minLengthSquared, float* t, float* x, float* y);
+
+// Squared distances from (px, py) to each segment's start, end and midpoint
+void pointDistances(const Segments& segments, const int* ids, size_t count, float px, float py,
+                    float* start, float* end, float* mid);
+
+// Whether segments a[i] and b[i] cross, with the parameter test of
+// IntersectionIndex::findIntersection (a[i] taking the role of p1-p2)
+void intersectPairs(const Segments& segments, const int* a, const int* b, size_t count, unsigned char* hit);
+
+// Whether each segment shares a point with the closed rectangle
+void overlapsRect(const Segments& segments, const int* ids, size_t count,
+                  float minX, float minY, float maxX, float maxY, unsigned char* hit);
+
+} // namespace GeometryKernels
+
+#endif // GEOMETRYKERNELS_H
@@ -0,0 +1,77 @@
+#ifndef INTERSECTIONINDEX_H
+#define INTERSECTIONINDEX_H
+
+#include <QVector2D>
+#include <vector>
+#include "LineStore.h"
+#include "SpatialHash.h"
+
+// Precomputed crossing points between document lines.
+//
+// The full set is built by testing each line against the lines that share
+// grid cells with it, and then kept up to date line by line: an edited line
+// only drops its own crossings and re-tests its cell neighbours again. That
+// line grid belongs to the index and is sized from the lines themselves, not
+// from the snap radius, so zooming never rebuilds the crossings. The points
+// live in their own spatial hash, so an intersection snap is a nearest-point
+// lookup around the cursor.
+//
+// Crossings that coincide with an endpoint of either line are not stored;
+// the endpoint snap always wins for those points.
+class IntersectionIndex
+{
+public:
+    IntersectionIndex();
+
+    // 'cellSize' is the grid of the crossing points, used by nearest()
+    void build(const LineStore& lines, float cellSize);
+    void clear();
+
+    float cellSize() const { return pointIndex.cellSize(); }
+    void setCellSize(float cellSize);  // Rehashes the stored points
+    size_t lineCount() const { return lineCrossings.size(); }
+    size_t crossingCount() const { return crossings.size() - freeCrossings.size(); }
+
+    // Picks up the current geometry of 'ids' and tests them again
+    void insertLines(const std::vector<int>& ids, const LineStore& lines);
+    void removeLines(const std::vector<int>& ids);
+
+    // Drops the given lines (ascending) and renumbers the ones after them
+    // the same way std::vector::erase would
+    void eraseAndCompact(const std::vector<int>& sortedIds);
+
+    // Closest stored crossing strictly within 'radius' of 'point'
+    bool nearest(const QVector2D& point, float radius, QVector2D& result, float& distance) const;
+
+    static bool findIntersection(const QVector2D& p1, const QVector2D& p2, const QVector2D& p3,
+                                 const QVector2D& p4, QVector2D& intersection);
+
+private:
+    struct Crossing {
+        QVector2D point;
+        int lineA;
+        int lineB;
+        bool alive;
+    };
+
+    void queuePair(int a, int b, const LineStore& lines);
+    void flushPairs(const LineStore& lines);
+    void testPair(int a, int b, const LineStore& lines);
+    void addCrossing(int a, int b, const QVector2D& point);
+    void removeCrossing(int id);
+
+    std::vector<Crossing> crossings;
+    std::vector<int> freeCrossings;
+    std::vector<std::vector<int>> lineCrossings;  // Crossing ids per line
+    SpatialHash lineIndex;                        // Lines, in cells about a line length wide
+    SpatialHash pointIndex;                       // Crossings stored as zero-length segments
+
+    std::vector<char> pending;                    // Lines queued in insertLines
+    std::vector<int> scratch;
+    std::vector<int> pairsA;                      // Pairs waiting for flushPairs
+    std::vector<int> pairsB;
+    std::vector<unsigned char> pairHits;
+    mutable std::vector<int> candidates;
+};
+
+#endif // INTERSECTIONINDEX_H
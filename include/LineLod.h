@@ -0,0 +1,48 @@
+#ifndef LINELOD_H
+#define LINELOD_H
+
+#include <QtGlobal>
+#include <vector>
+#include "LineStore.h"
+
+// Level-of-detail hierarchy for drawing huge documents zoomed out.
+//
+// Level k splits the drawing's extent into square cells of baseCellSize *
+// 2^k. Lines no longer than a cell collapse at that level: each occupied
+// cell is drawn as a single point at one of its lines (the lowest index),
+// which is what a sub-pixel segment looks like anyway. Longer lines are
+// still drawn as they are.
+//
+// Lines are ordered by the level at which they collapse, latest first, so
+// the lines still drawn at any level are a prefix of linesByLevel().
+class LineLod
+{
+public:
+    void build(const LineStore& lines);
+    void clear();
+
+    int levelCount() const { return static_cast<int>(levels.size()); }
+
+    // Coarsest level whose cells are no larger than 'cellSize' (e.g. the
+    // world size of a pixel), or -1 when even the finest cells are larger
+    int levelFor(float cellSize) const;
+
+    // Representative line of every occupied cell at 'level'
+    const std::vector<quint32>& cellLines(int level) const { return levels[level].cells; }
+
+    // Number of leading linesByLevel() entries that do not collapse at 'level'
+    size_t longLineCount(int level) const { return levels[level].longLines; }
+    const std::vector<quint32>& linesByLevel() const { return orderedLines; }
+
+private:
+    struct Level {
+        float cellSize;
+        std::vector<quint32> cells;
+        size_t longLines;
+    };
+
+    std::vector<Level> levels;
+    std::vector<quint32> orderedLines;
+};
+
+#endif // LINELOD_H
@@ -0,0 +1,170 @@
+#ifndef LINERENDERER_H
+#define LINERENDERER_H
+
+#include <QOpenGLFunctions>
+#include <QOpenGLBuffer>
+#include <QOpenGLVertexArrayObject>
+#include <QOpenGLShaderProgram>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <utility>
+#include "Document.h"
+#include "LineLod.h"
+
+// Retained GPU copy of the document's lines.
+//
+// Every line owns two consecutive vertices (position + line index) in a
+// single vertex buffer, so the whole document is drawn with one
+// glDrawArrays call. Colour and display state (selected, hovered, hidden)
+// live apart from the geometry, one texel per line in an attribute
+// texture the vertex shader looks up by line index. Recolouring or
+// selecting lines therefore rewrites a few texture rows and never touches
+// the vertex buffer.
+//
+// sync() replays the document's change log since the last upload and
+// rewrites only the affected line ranges; it and draw() must run with the
+// GL context current (i.e. from paintGL).
+class LineRenderer : protected QOpenGLFunctions
+{
+public:
+    enum AttributeFlag {
+        Selected = 0x1,
+        Hovered = 0x2,
+        Hidden = 0x4
+    };
+
+    LineRenderer();
+    ~LineRenderer();
+
+    void initialize();  // Call from initializeGL()
+    void cleanup();     // Call with the context current before it goes away
+
+    // False when the context cannot run the line shader (initialize() logs
+    // why); sync() and the draw calls then do nothing
+    bool isAvailable() const { return initialized; }
+
+    // Forces a full upload on the next sync (e.g. after context loss)
+    void invalidateAll();
+
+    // Upload whatever changed since the last sync and draw all lines
+    void sync(const Document& document);
+    void draw();
+
+    // Draws only the given lines (e.g. those in view); falls back to draw()
+    // when they are a large share of the document anyway
+    void draw(const std::vector<int>& visibleLines);
+
+    // Zoomed out far enough that most lines are smaller than 'worldPerPixel',
+    // draws them collapsed to one point per pixel-sized cell (see LineLod)
+    // and returns true. Selected and hovered lines are drawn on top as they
+    // are, so they never vanish into a cell. Returns false, drawing nothing,
+    // when the lines should be drawn as they are, and also while geometry
+    // edits have left the hierarchy out of date: a zoomed-out frame then
+    // starts a rebuild on a worker thread, and the callback runs (on that
+    // thread) once the result can be drawn.
+    bool drawLevelOfDetail(const Document& document, float worldPerPixel);
+    void setLevelOfDetailCallback(std::function<void()> ready) { lodReady = std::move(ready); }
+    void waitForLevelOfDetail();  // Blocks until a rebuild in progress is done
+
+    // Display state by line index, applied after sync() so the indices
+    // match the document. Only lines whose state changes are re-uploaded.
+    void setSelection(const std::vector<int>& sortedIndices);
+    void setHovered(int index);  // -1 for none
+    void setHidden(const std::vector<int>& indices, bool hidden);
+
+    // Marks 'index' as hovered and draws just that line over whatever is
+    // already on screen, e.g. a cached image of the scene drawn without it
+    void drawHovered(int index);
+
+    size_t lineCount() const { return uploadedLines; }
+
+private:
+    struct Vertex {
+        float x;
+        float y;
+        float line;  // Index into the attribute texture; exact up to 2^24 lines
+    };
+
+    // One texel of the attribute texture
+    struct LineAttributes {
+        unsigned char r;
+        unsigned char g;
+        unsigned char b;
+        unsigned char flags;
+    };
+
+    // A level-of-detail hierarchy and its GPU data, built off the GL thread
+    struct LevelOfDetail {
+        quint64 version = 0;              // Document version it was built from
+        LineLod lod;
+        std::vector<Vertex> points;       // Cell points of every level back to back
+        std::vector<size_t> pointOffsets; // First point of each level, plus the total
+        std::vector<GLuint> lineIndices;  // Lines still drawn at the finest level
+    };
+
+    static void packLine(const LineStore& lines, size_t index, Vertex* out);
+    void setupAttributes();
+    void beginDraw();
+    void endDraw();
+    void bindLines();
+    void releaseLines();
+    void drawLines(const std::vector<int>& lineIndices, GLenum mode);
+    static void buildLevelOfDetail(const LineStore& lines, LevelOfDetail& out);
+    void followLevelOfDetail(const Document& document);
+    void startLevelOfDetail(const Document& document);
+    void joinLevelOfDetail();
+    void reallocate(const LineStore& lines);
+    void resetAttributes(const LineStore& lines);
+    void eraseAttributes(const std::vector<int>& sortedIndices, size_t lineCount);
+    void setFlag(size_t index, unsigned char flag, bool on);
+    void markAttributeRows(size_t first, size_t last);
+    void uploadAttributes();
+
+    QOpenGLBuffer vertexBuffer;
+    QOpenGLBuffer indexBuffer;  // Vertex indices of the lines in view, rewritten per culled draw
+    QOpenGLVertexArrayObject vao;
+    QOpenGLShaderProgram program;
+    GLuint attributeTexture;
+    bool initialized;
+
+    quint64 syncedVersion;   // Document version the buffer reflects
+    size_t uploadedLines;    // Lines currently valid on the GPU
+    size_t capacityLines;    // Lines the GPU buffer can hold without reallocating
+    bool fullUpload;         // Rebuild the whole buffer on next sync
+    std::vector<std::pair<size_t, size_t>> dirtyRanges;    // [first, last) in lines
+    std::vector<std::pair<size_t, size_t>> recolourRanges; // Lines whose colour must be re-read
+    std::vector<Vertex> staging;
+    std::vector<GLuint> visibleIndices;
+    std::vector<const DocumentChange*> changes;
+
+    // CPU mirror of the attribute texture, a whole number of rows long.
+    // Rows are uploaded whole, so scattered edits cost one row each.
+    std::vector<LineAttributes> attributes;
+    std::vector<bool> dirtyRows;
+    bool attributesDirty;
+    std::vector<int> selectedLines;  // Ascending; lines carrying the Selected flag
+    int hoveredLine;
+
+    // Level of detail: cell points of every level back to back, and the
+    // vertex indices of the lines in LineLod::linesByLevel() order that are
+    // still drawn at the finest level
+    LineLod lod;
+    quint64 lodVersion;                   // Document version the hierarchy matches
+    QOpenGLBuffer lodPointBuffer;
+    QOpenGLBuffer lodIndexBuffer;
+    std::vector<size_t> lodPointOffsets;  // First point of each level, plus the total
+    std::vector<int> highlightLines;      // Selected and hovered lines drawn over the cells
+    std::vector<int> hoveredLines;        // The one line drawHovered() draws
+
+    // At most one rebuild runs at a time, on its own copy of the lines
+    std::thread lodThread;
+    bool lodBuilding;
+    std::mutex lodMutex;
+    std::unique_ptr<LevelOfDetail> lodFinished;  // Guarded by lodMutex
+    std::function<void()> lodReady;
+};
+
+#endif // LINERENDERER_H
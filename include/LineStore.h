@@ -0,0 +1,68 @@
+#ifndef LINESTORE_H
+#define LINESTORE_H
+
+#include <QColor>
+#include <QVector2D>
+#include <algorithm>
+#include <vector>
+#include "Line.h"
+
+// Column-wise storage of the drawing's lines.
+//
+// Each attribute has its own contiguous array: the endpoints as four float
+// columns and the colour packed into a 32-bit QRgb. A line takes 20 bytes
+// instead of the 32 of a Line, and loops over the geometry never pull
+// colours into the cache. Bounding boxes are derived from the coordinate
+// columns on demand; storing them would cost more than recomputing them.
+//
+// Line stays the value type for handing single lines around.
+class LineStore
+{
+public:
+    size_t size() const { return x0s.size(); }
+    bool empty() const { return x0s.empty(); }
+
+    float x0(size_t i) const { return x0s[i]; }
+    float y0(size_t i) const { return y0s[i]; }
+    float x1(size_t i) const { return x1s[i]; }
+    float y1(size_t i) const { return y1s[i]; }
+    QVector2D start(size_t i) const { return QVector2D(x0s[i], y0s[i]); }
+    QVector2D end(size_t i) const { return QVector2D(x1s[i], y1s[i]); }
+    QRgb rgba(size_t i) const { return colors[i]; }
+    QColor color(size_t i) const { return QColor::fromRgba(colors[i]); }
+    Line line(size_t i) const { return Line(start(i), end(i), color(i)); }
+
+    float minX(size_t i) const { return std::min(x0s[i], x1s[i]); }
+    float minY(size_t i) const { return std::min(y0s[i], y1s[i]); }
+    float maxX(size_t i) const { return std::max(x0s[i], x1s[i]); }
+    float maxY(size_t i) const { return std::max(y0s[i], y1s[i]); }
+
+    // Raw columns, size() entries each
+    const float* x0Data() const { return x0s.data(); }
+    const float* y0Data() const { return y0s.data(); }
+    const float* x1Data() const { return x1s.data(); }
+    const float* y1Data() const { return y1s.data(); }
+    const QRgb* rgbaData() const { return colors.data(); }
+
+    void reserve(size_t count);
+    void clear();
+    void push_back(const Line& line);
+    void push_back(float x0, float y0, float x1, float y1, QRgb rgba);
+    void append(const LineStore& other);
+
+    void translate(size_t i, float dx, float dy);
+    void setGeometry(size_t i, float x0, float y0, float x1, float y1);
+    void setColor(size_t i, QRgb rgba) { colors[i] = rgba; }
+
+    // Removes the given lines (ascending) in one compaction pass
+    void eraseSorted(const std::vector<int>& sortedIndices);
+
+private:
+    std::vector<float> x0s;
+    std::vector<float> y0s;
+    std::vector<float> x1s;
+    std::vector<float> y1s;
+    std::vector<QRgb> colors;
+};
+
+#endif // LINESTORE_H
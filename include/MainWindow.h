@@ -5,6 +5,8 @@
 #include <QStatusBar>
 #include <QOpenGLWidget>
 #include <QOpenGLFunctions>
+#include <utility>
+#include <vector>
 #include "GLWidget.h"  // Add this include
 
 class GLWidget;
@@ -27,11 +29,14 @@ private slots:
     void onStartMove();
     void onZoomAll();
     void showColorDialog();
+    void onSnapModesChanged();
+    void onWeldEndpointsToggled(bool enabled);
 
 private:
     void createActions();
     void createMenus();
     void createToolbars();
+    void createSnapActions();
 
     GLWidget* glWidget;
     QAction* colorAction;
@@ -42,6 +47,9 @@ private:
     QToolButton* moveButton;
     QToolButton* deleteButton;
     QToolButton* dimensionButton;
+
+    // Checkable object snap toggles and the SnapManager::SnapMode each sets
+    std::vector<std::pair<QAction*, unsigned>> snapModeActions;
 };
 
 #endif // MAINWINDOW_H
@@ -0,0 +1,76 @@
+#ifndef RTREE_H
+#define RTREE_H
+
+#include <QRectF>
+#include <vector>
+
+// R-tree of axis-aligned boxes, addressed by id (the line index).
+//
+// build() bulk-loads with sort-tile-recursive packing; insert/remove/update
+// keep the tree current afterwards. Queries report entries lying completely
+// inside the query rectangle separately from those that only overlap it, and
+// whole subtrees inside the rectangle are reported without visiting their
+// entries one by one.
+//
+// Removal does not rebalance underfull nodes (empty ones are dropped), so
+// after heavy editing a rebuild gives tighter nodes.
+class RTree
+{
+public:
+    struct Box {
+        float minX, minY, maxX, maxY;
+    };
+
+    RTree();
+
+    void build(const std::vector<Box>& boxes);  // Ids are the box indices
+    void clear();
+
+    void insert(int id, const Box& box);
+    void remove(int id);
+    void update(int id, const Box& box);
+
+    // Removes the given ids (ascending) and renumbers the ones after them
+    // the same way std::vector::erase would
+    void eraseAndCompact(const std::vector<int>& sortedIds);
+
+    // Ids whose boxes lie inside 'rect' (edges included) go to 'inside'; when
+    // 'overlapping' is given, ids whose boxes only overlap it go there. A rect
+    // with zero width or height contains nothing, like QRectF::contains.
+    // Neither list is sorted.
+    void query(const QRectF& rect, std::vector<int>& inside, std::vector<int>* overlapping) const;
+
+    size_t size() const { return count; }
+
+private:
+    struct Entry {
+        Box box;
+        int id;  // Line id in leaves, child node index otherwise
+    };
+
+    struct Node {
+        std::vector<Entry> entries;
+        int parent;
+        bool leaf;
+    };
+
+    int allocateNode(bool leaf, int parent);
+    void freeNode(int node);
+    Box nodeBox(int node) const;
+    int chooseLeaf(const Box& box) const;
+    void splitNode(int node);
+    void refreshUpward(int node);
+    void removeEmptyNode(int node);
+    int buildLevel(std::vector<Entry>& entries, bool leaf);
+    void collect(int node, std::vector<int>& out) const;
+    void queryNode(int node, const QRectF& rect, bool canContain, std::vector<int>& inside,
+                   std::vector<int>* overlapping) const;
+
+    std::vector<Node> nodes;
+    std::vector<int> freeNodes;
+    std::vector<int> leafOf;  // Leaf node per id, -1 if absent
+    int root;
+    size_t count;
+};
+
+#endif // RTREE_H
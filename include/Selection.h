@@ -0,0 +1,54 @@
+#ifndef SELECTION_H
+#define SELECTION_H
+
+#include <QRectF>
+#include <QVector2D>
+#include <vector>
+#include "Document.h"
+#include "RTree.h"
+
+// Picking, rectangle selection and view culling over the document's lines,
+// kept apart from GLWidget so the same routines can be exercised without a
+// window.
+//
+// Line bounding boxes live in an R-tree that follows the document's change
+// log, so a query only runs the exact segment tests on lines near the
+// rectangle; lines whose boxes lie inside it are taken without testing.
+class Selection
+{
+public:
+    explicit Selection(const Document& document);
+
+    // First line within 'radius' of 'point', or -1
+    int pickLine(const QVector2D& point, float radius);
+
+    // Window selection takes lines that lie completely inside 'worldRect';
+    // crossing selection also takes lines that cross or touch its edges.
+    // Appends the matching indices to 'out' in ascending order.
+    void selectInRect(const QRectF& worldRect, bool crossing, std::vector<int>& out);
+
+    // Lines whose bounding boxes touch 'worldRect', in no particular order;
+    // used to cull the lines outside the view before drawing. Replaces 'out'.
+    void linesInRect(const QRectF& worldRect, std::vector<int>& out);
+
+private:
+    void syncWithDocument();
+    void rebuildTree();
+
+    const Document& document;     // Not owned; outlives the selection
+    quint64 syncedVersion;        // Document version the tree reflects
+    std::vector<const DocumentChange*> changes;
+
+    RTree tree;
+    bool treeValid;
+    std::vector<int> staleBoxes;  // Lines whose tree boxes wait for the current geometry
+
+    // Query scratch, kept to avoid reallocating per mouse event
+    std::vector<int> inside;
+    std::vector<int> candidates;
+    std::vector<char> marks;
+    std::vector<float> distances;
+    std::vector<unsigned char> hits;
+};
+
+#endif // SELECTION_H
@@ -0,0 +1,46 @@
+#ifndef SELECTIONSET_H
+#define SELECTIONSET_H
+
+#include <QtGlobal>
+#include <vector>
+
+// Set of selected line indices.
+//
+// Membership lives in a dense bitset, so contains() is a single word test
+// and inverting touches one bit per line. The ascending list that edits
+// and drawing iterate over is rebuilt from the bits only when it is asked
+// for after an out-of-order change.
+class SelectionSet
+{
+public:
+    SelectionSet();
+
+    bool empty() const { return count == 0; }
+    size_t size() const { return count; }
+
+    bool contains(int index) const
+    {
+        const size_t word = static_cast<size_t>(index) >> 6;
+        return index >= 0 && word < bits.size() && (bits[word] >> (index & 63)) & 1u;
+    }
+
+    void clear();
+    void insert(int index);
+    void remove(int index);
+
+    void assign(const std::vector<int>& indices);
+    void unite(const std::vector<int>& indices);     // Adds the indices
+    void subtract(const std::vector<int>& indices);  // Drops the indices
+    void invert(size_t lineCount);                   // Selects exactly the unselected lines below lineCount
+
+    // Selected indices in ascending order
+    const std::vector<int>& indices() const;
+
+private:
+    std::vector<quint64> bits;
+    size_t count;
+    mutable std::vector<int> list;
+    mutable bool listValid;
+};
+
+#endif // SELECTIONSET_H
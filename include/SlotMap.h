@@ -0,0 +1,73 @@
+#ifndef SLOTMAP_H
+#define SLOTMAP_H
+
+#include <QtGlobal>
+#include <unordered_map>
+#include <vector>
+
+// Stable reference to one entity of the document. Unlike a line index it
+// survives removals of other lines, and it stops resolving once its own
+// line is gone (the slot's generation moves on).
+struct EntityHandle {
+    static const quint32 invalidSlot = 0xffffffffu;
+
+    quint32 slot = invalidSlot;
+    quint32 generation = 0;
+
+    bool isNull() const { return slot == invalidSlot; }
+    bool operator==(const EntityHandle& other) const { return slot == other.slot && generation == other.generation; }
+    bool operator!=(const EntityHandle& other) const { return !(*this == other); }
+};
+
+// Maps handles to positions in a dense, ordered array kept elsewhere (the
+// LineStore columns). Entities are appended at the end and removed in
+// batches with the same order-preserving compaction the columns use, so
+// iteration stays a plain loop over the columns.
+//
+// Slots are only created for entities whose handle has been asked for, so
+// a drawing of millions of lines pays nothing for the few handles the UI
+// holds. Handle lookup and slot creation are O(1); appending costs nothing;
+// a batch removal is one pass over the entities that have slots.
+class SlotMap
+{
+public:
+    size_t size() const { return entityCount; }
+
+    // Creates the entity's slot on first use
+    EntityHandle handleAt(size_t index) const;
+
+    // Position of the entity, or -1 if the handle is stale or null
+    int indexOf(const EntityHandle& handle) const
+    {
+        if (handle.slot >= slotTable.size()) return -1;
+        const Slot& slot = slotTable[handle.slot];
+        return slot.generation == handle.generation && slot.index != freeIndex ? static_cast<int>(slot.index) : -1;
+    }
+
+    EntityHandle push_back();
+    void append(size_t count) { entityCount += count; }
+    void reset(size_t count);  // 'count' entities without slots; all older handles go stale
+
+    // Releases the entities at the given positions (ascending) and shifts
+    // the ones after them down, like std::vector::erase would
+    void eraseSorted(const std::vector<int>& sortedIndices);
+
+private:
+    static const quint32 freeIndex = 0xffffffffu;
+
+    struct Slot {
+        quint32 index;       // Position of the entity, freeIndex when unused
+        quint32 generation;  // Bumped on release so old handles stop matching
+    };
+
+    void releaseSlot(quint32 slot);
+
+    size_t entityCount = 0;
+
+    // Filled in by handleAt(), which is logically const
+    mutable std::vector<Slot> slotTable;
+    mutable std::vector<quint32> freeSlots;
+    mutable std::unordered_map<quint32, quint32> slotOfIndex;  // Only entities with slots
+};
+
+#endif // SLOTMAP_H
@@ -1,8 +1,15 @@
-#pragma once
+#ifndef SNAPMANAGER_H
+#define SNAPMANAGER_H
 
 #include <QVector2D>
+#include <array>
+#include <utility>
 #include <vector>
+#include <QtGlobal>
 #include "Line.h"
+#include "Document.h"
+#include "SpatialHash.h"
+#include "IntersectionIndex.h"
 
 class SnapManager {
 public:
@@ -10,29 +17,110 @@ public:
         SNAP_NONE,
         SNAP_ENDPOINT,
         SNAP_MIDPOINT,
-        SNAP_INTERSECTION,  // Add intersection snap type
+        SNAP_INTERSECTION,
+        SNAP_PERPENDICULAR,
         SNAP_LINE
     };
 
-    SnapManager(float snapThreshold, float zoomLevel, const std::vector<Line>& lines);
+    // Object snaps the user can switch on and off. Passes run in this
+    // order and the first one that finds a point within the radius wins.
+    enum SnapMode : unsigned {
+        SnapEndpoint      = 1u << 0,
+        SnapIntersection  = 1u << 1,
+        SnapMidpoint      = 1u << 2,
+        SnapPerpendicular = 1u << 3,  // Foot of the perpendicular from the reference point
+        SnapNearest       = 1u << 4,  // Closest point on a line
+        AllSnapModes      = (1u << 5) - 1
+    };
+
+    SnapManager(float snapThreshold, float zoomLevel, const Document& document);
     ~SnapManager();
 
-    QVector2D snapPoint(const QVector2D& point);
+    // Only the snap radius changes here; the indices follow the document
+    // on their own
+    void updateSettings(float newSnapThreshold, float newZoom);
     void updateSnap(const QVector2D& point);
+
+    void setSnapModes(unsigned modes);  // SnapMode flags
+    unsigned snapModes() const { return modes; }
+
+    // Point perpendicular snaps are measured from, e.g. the start of the
+    // line being drawn
+    void setReferencePoint(const QVector2D& point);
+    void clearReferencePoint();
     bool isSnapActive() const { return snapActive; }
-    void drawSnapMarker(const QVector2D& pan, float zoom);
-    void updateSettings(float newSnapThreshold, float newZoom, const std::vector<Line>& lines);
     QVector2D getCurrentSnapPoint() const { return currentSnapPoint; }
-    bool hasCurrentSnapPoint() const { return getCurrentSnapPoint() != nullptr; }
+    SnapType snapType() const { return currentSnapType; }
+    void drawSnapMarker(const QVector2D& pan, float zoom);
+    // Marker for a snap found elsewhere (e.g. by the SnapWorker)
+    static void drawSnapMarker(const QVector2D& point, SnapType type, float zoom);
+    bool checkTempPoint(const QVector2D& point, const QVector2D& tempPoint, bool hasTempPoint);
 
 private:
-    // Add the intersection helper function declaration
-    static bool findIntersection(const Line& line1, const Line& line2, QVector2D& intersection);
+    QVector2D snapPoint(const QVector2D& point);
+    void syncWithDocument();
+    void ensureIndices(float effectiveThreshold);
+    void updateCandidates(const QVector2D& point, float radius);
+
+    // The snap passes for one combination of modes, with the disabled ones
+    // compiled out; snapPoint() picks the instance through 'kernels'
+    template <unsigned Modes>
+    void snapKernel(const QVector2D& point, float effectiveThreshold);
+    using Kernel = void (SnapManager::*)(const QVector2D&, float);
+    template <size_t... Masks>
+    static constexpr std::array<Kernel, sizeof...(Masks)> makeKernels(std::index_sequence<Masks...>);
+    static const std::array<Kernel, AllSnapModes + 1> kernels;
+
+    // Keep the spatial indices in step with document edits
+    void linesAdded(size_t first, size_t count);
+    void linesChanged(const std::vector<int>& indices);
+    void linesRemoved(const std::vector<int>& sortedIndices);  // Ascending, pre-removal indices
+    void linesReset();
 
     float snapThreshold;
     float zoom;
-    std::vector<Line> lines;
+    const Document& document;     // Not owned; outlives the manager
+    unsigned modes;
+    QVector2D referencePoint;
+    bool hasReferencePoint;
+    quint64 syncedVersion;        // Document version the indices reflect
+    std::vector<const DocumentChange*> changes;
+
+    // Grid of line ids with cells sized from the snap radius
+    SpatialHash lineIndex;
+    bool lineIndexValid;
+
+    // Crossing points of all line pairs, kept in step with the document
+    // while intersection snapping is on
+    IntersectionIndex intersections;
+    bool intersectionsValid;
+
+    // Lines that may come within the snap radius of any point less than
+    // guardRadius from cacheCenter. Successive cursor positions are a few
+    // pixels apart, so most queries reuse the set instead of searching the
+    // grid; it is refilled once the cursor leaves the guard region, or the
+    // document or the snap radius changes.
+    std::vector<int> candidates;
+    bool candidatesValid;
+    QVector2D cacheCenter;
+    float cacheRadius;
+    float guardRadius;
+    quint64 cacheVersion;
+
+    // Per-candidate results of the batched distance kernels
+    std::vector<float> scratch;
+
+    // Result of the last query, handed out again when the same point is
+    // asked for while the candidates still hold (hover, then click)
+    bool memoValid;
+    QVector2D memoPoint;
+    QVector2D memoSnapPoint;
+    bool memoActive;
+    SnapType memoType;
+
     QVector2D currentSnapPoint;
     bool snapActive;
     SnapType currentSnapType;
-};
\ No newline at end of file
+};
+
+#endif // SNAPMANAGER_H
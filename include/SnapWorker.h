@@ -0,0 +1,115 @@
+#ifndef SNAPWORKER_H
+#define SNAPWORKER_H
+
+#include <QObject>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QVector2D>
+#include <QtGlobal>
+#include <vector>
+#include "Document.h"
+#include "LineStore.h"
+#include "SnapManager.h"
+
+// One snap query with the settings it runs under.
+struct SnapQuery {
+    QVector2D point;
+    float snapThreshold = 5.0f;  // Pixels
+    float zoom = 1.0f;
+    unsigned modes = SnapManager::AllSnapModes;  // SnapManager::SnapMode flags
+    bool hasReferencePoint = false;
+    QVector2D referencePoint;    // For perpendicular snaps
+};
+
+// Outcome of one snap query.
+struct SnapResult {
+    QVector2D point;                                      // Snapped position; the query point when inactive
+    SnapManager::SnapType type = SnapManager::SNAP_NONE;
+    bool active = false;
+    quint64 sequence = 0;                                 // Request this answers, from requestSnap()/snapNow()
+};
+
+// Runs snap queries on whichever thread it lives in.
+//
+// Move it to a worker QThread and connect QThread::started to run(). The
+// worker snaps against its own replica of the document, so a slow pass on a
+// large drawing never holds up the GUI thread. Both request functions first
+// forward the edits made to the GUI's document since the previous request
+// (replayed from its change log), so every query sees the document as it
+// was when it was posted.
+//
+// requestSnap() is latest-wins: a request still waiting when a newer one
+// arrives is dropped, and results come back through snapFound(). snapNow()
+// blocks until the worker has answered that exact point, for clicks that
+// must not act on a stale snap.
+class SnapWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SnapWorker(QObject* parent = nullptr);
+
+    // GUI thread only. Return the sequence number of the request.
+    quint64 requestSnap(const Document& document, const SnapQuery& query);
+    SnapResult snapNow(const Document& document, const SnapQuery& query);
+
+    // Sequence number of the newest request posted so far
+    quint64 lastSequence() const { return postedSequence; }
+
+    // Thread-safe; run() returns after the query in progress
+    void stop();
+
+public slots:
+    void run();
+
+signals:
+    void snapFound(const SnapResult& result);
+
+private:
+    // One edit to replay on the replica. Removals carry the pre-removal
+    // indices; everything else is the final geometry of 'indices', where
+    // indices past the replica's end are appended.
+    struct DocumentUpdate {
+        enum Type { Reset, Remove, Assign };
+        Type type;
+        std::vector<int> indices;  // Ascending
+        LineStore lines;           // All lines for Reset, one per index for Assign
+    };
+
+    struct Request {
+        SnapQuery query;
+        quint64 sequence;
+        bool exact;
+    };
+
+    // GUI thread
+    void forwardChanges(const Document& document, std::vector<DocumentUpdate>& out);
+    quint64 post(const Document& document, const SnapQuery& query, bool exact);
+
+    // Worker thread
+    void apply(DocumentUpdate& update);
+    SnapResult snap(const Request& request);
+
+    // Shared, guarded by 'mutex'
+    QMutex mutex;
+    QWaitCondition requestPosted;
+    QWaitCondition exactAnswered;
+    std::vector<DocumentUpdate> pendingUpdates;  // In document order, never dropped
+    Request pending;
+    bool hasPending;
+    bool stopRequested;
+    SnapResult exactResult;
+
+    // GUI thread
+    quint64 forwardedVersion;  // GUI document version the replica will reach
+    quint64 postedSequence;
+    std::vector<const DocumentChange*> changes;
+
+    // Worker thread
+    Document replica;
+    SnapManager snapManager;  // Bound to 'replica'
+};
+
+Q_DECLARE_METATYPE(SnapResult)
+
+#endif // SNAPWORKER_H
@@ -0,0 +1,81 @@
+#ifndef SPATIALHASH_H
+#define SPATIALHASH_H
+
+#include <QVector2D>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+
+// World-space grid of line segments, addressed by line index.
+//
+// Each segment is registered in every cell it passes through, so any
+// segment that comes within 'radius' of a query point is found by looking
+// only at the cells overlapping the query square. The grid has several
+// levels whose cells double in size; a segment goes into the finest level
+// where it crosses at most maxCellsPerSegment cells, so a long line costs
+// a handful of coarse cells instead of thousands of fine ones and is only
+// returned by queries that land near it.
+class SpatialHash
+{
+public:
+    explicit SpatialHash(float cellSize = 1.0f);
+
+    float cellSize() const { return cellWidth; }
+    void setCellSize(float newSize);  // Drops all entries
+
+    void clear();
+    void insert(int id, const QVector2D& start, const QVector2D& end);
+    void remove(int id);
+    void update(int id, const QVector2D& start, const QVector2D& end);
+
+    // Removes the given ids (ascending) and renumbers the ones after them
+    // the same way std::vector::erase would
+    void eraseAndCompact(const std::vector<int>& sortedIds);
+
+    // Collects the ids of all segments that may come within 'radius' of
+    // 'center', in ascending order without duplicates
+    void query(const QVector2D& center, float radius, std::vector<int>& out) const;
+
+    // Collects the ids of all segments sharing a cell with the given segment
+    void querySegment(const QVector2D& start, const QVector2D& end, std::vector<int>& out) const;
+
+    size_t size() const { return entries.size(); }
+
+private:
+    struct Entry {
+        float x0, y0, x1, y1;
+        int level = 0;
+        bool inserted = false;
+    };
+
+    struct Level {
+        float width;
+        std::unordered_map<uint64_t, std::vector<int>> cells;
+    };
+
+    static constexpr int maxCellsPerSegment = 16;
+    static constexpr int maxLevels = 48;
+
+    static int cellCoord(float v, float width);
+    static uint64_t cellKey(int cx, int cy)
+    {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(cx)) << 32) | static_cast<uint32_t>(cy);
+    }
+
+    template <typename Visitor>
+    static void forEachCell(const Entry& entry, float width, Visitor&& visit);
+    static long long cellSpan(const Entry& entry, float width);
+    int levelFor(const Entry& entry) const;
+    Level& levelAt(int level);
+    void beginQuery() const;
+
+    float cellWidth;
+    std::vector<Level> levels;       // levels[k] has cells cellWidth * 2^k wide
+    std::vector<Entry> entries;      // Indexed by id
+
+    // Per-id stamps used to de-duplicate ids that span several query cells
+    mutable std::vector<uint32_t> visitStamps;
+    mutable uint32_t currentStamp = 0;
+};
+
+#endif // SPATIALHASH_H
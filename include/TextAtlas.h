@@ -0,0 +1,100 @@
+#ifndef TEXTATLAS_H
+#define TEXTATLAS_H
+
+#include <QOpenGLFunctions>
+#include <QOpenGLBuffer>
+#include <QOpenGLShaderProgram>
+#include <QFont>
+#include <QHash>
+#include <QImage>
+#include <QVector2D>
+#include <vector>
+
+// A string laid out for a TextAtlas: one quad per glyph, in device pixels
+// around the string's centre, with atlas coordinates in pixels (so the
+// atlas can grow without invalidating layouts).
+struct TextLayout {
+    struct Quad {
+        float x0, y0, x1, y1;  // Offsets from the anchor, y up
+        float u0, v0, u1, v1;  // Atlas pixels, v down
+    };
+
+    std::vector<Quad> quads;
+    quint64 atlasGeneration = 0;  // Atlas the quads refer to; 0 = not laid out
+};
+
+// Screen-aligned text drawn from a glyph atlas.
+//
+// Glyphs are rasterised once with QPainter into an atlas texture. Strings
+// are laid out into quads once (the caller keeps the TextLayout). The
+// labels of a frame are collected into a batch that is drawn with a single
+// call. The batch stays on the GPU until the next clear(), so a frame that
+// shows the same labels only sets the view uniforms.
+//
+// Labels keep their pixel size at any zoom: the vertex shader places each
+// quad around its anchor's projected position. All calls except layout()
+// must run with the GL context current.
+class TextAtlas : protected QOpenGLFunctions
+{
+public:
+    TextAtlas();
+    ~TextAtlas();
+
+    // (Re)creates the atlas for 'font' rendered at 'devicePixelRatio'; older
+    // layouts stop being current
+    void initialize(const QFont& font, qreal devicePixelRatio);
+    void cleanup();
+
+    qreal devicePixelRatio() const { return pixelRatio; }
+    bool isCurrent(const TextLayout& layout) const { return layout.atlasGeneration == generation; }
+
+    // Lays out 'text' centred on its anchor, adding missing glyphs to the atlas
+    void layout(const QString& text, TextLayout& out);
+
+    // Batch of labels drawn by draw()
+    void clear();
+    void addText(const QVector2D& anchor, const TextLayout& layout);
+
+    // Draws the batch with the current fixed-function matrices; 'viewport'
+    // is in device pixels
+    void draw(const QSize& viewport, const QColor& color);
+
+private:
+    struct Glyph {
+        float u0, v0, u1, v1;  // Cell in the atlas image
+        float advance;
+    };
+
+    struct Vertex {
+        float anchorX, anchorY;
+        float offsetX, offsetY;
+        float u, v;
+    };
+
+    const Glyph& glyph(QChar character);
+    void setupAttributes();
+
+    QFont font;
+    qreal pixelRatio;
+    quint64 generation;
+    bool initialized;
+
+    // Shelf-packed atlas; grows downwards when full
+    QImage atlas;
+    QHash<QChar, Glyph> glyphs;
+    int shelfX;
+    int shelfY;
+    int lineHeight;
+    int ascent;
+    bool atlasDirty;
+    QSize textureSize;  // Atlas size the texture was last allocated with
+
+    GLuint atlasTexture;
+    QOpenGLBuffer vertexBuffer;
+    QOpenGLShaderProgram program;
+    std::vector<Vertex> batch;
+    bool batchDirty;
+    size_t uploadedVertices;
+};
+
+#endif // TEXTATLAS_H
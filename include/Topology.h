@@ -0,0 +1,102 @@
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+#include <QVector2D>
+#include <QtGlobal>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "Document.h"
+#include "LineStore.h"
+
+// Shared vertex table for the document's line endpoints.
+//
+// Endpoints within 'tolerance' of each other are welded into one vertex,
+// and each vertex keeps the list of line ends that meet there, so
+// connectivity queries walk vertices instead of comparing coordinates.
+// Vertices are looked up through a hash of their quantized positions.
+//
+// The table follows the document's change log like Selection does and is
+// only built on first use; clear() drops it again. Vertex ids are not
+// stable across edits.
+class Topology
+{
+public:
+    static constexpr float defaultTolerance = 1e-4f;
+
+    explicit Topology(const Document& document, float tolerance = defaultTolerance);
+
+    float tolerance() const { return weldTolerance; }
+    void setTolerance(float tolerance);  // Rebuilds the table on next use
+
+    void clear();  // Frees the table until the next query
+
+    size_t vertexCount();
+    QVector2D vertexPosition(int vertex);
+    int startVertex(int line);
+    int endVertex(int line);
+
+    // Lines that start or end at 'vertex', each once, in no particular order
+    void linesAt(int vertex, std::vector<int>& out);
+
+    // Vertex within the tolerance of 'point', or -1
+    int findVertex(const QVector2D& point);
+
+    // Where a new endpoint at 'point' should go: the position of the vertex
+    // it welds to, or 'point' itself
+    QVector2D weld(const QVector2D& point);
+
+    // Welds the endpoints of lines about to be added to the document's
+    // vertices and to each other
+    void weldLines(LineStore& lines);
+
+    // All lines joined to 'lines' through shared vertices, including them,
+    // in ascending order. Replaces 'out'.
+    void connectedLines(const std::vector<int>& lines, std::vector<int>& out);
+
+private:
+    struct Vertex {
+        QVector2D point;
+        int firstEnd;     // Head of the list through nextEnd; -1 once freed
+        int nextInCell;   // Next vertex in the same hash bucket
+    };
+
+    // Line ends are numbered 2 * line for the start and 2 * line + 1 for the end
+    void syncWithDocument();
+    void rebuild();
+    void attach(int end, const QVector2D& point);
+    void detach(int end);
+    void eraseAndCompact(const std::vector<int>& sortedLines);
+
+    int64_t cellCoord(double v) const;
+    static uint64_t cellKey(int64_t cx, int64_t cy)
+    {
+        // Distinct cells may share a bucket; lookups compare positions anyway
+        return static_cast<uint64_t>(cx) * 0x9E3779B97F4A7C15ull ^ static_cast<uint64_t>(cy);
+    }
+    uint64_t pointKey(const QVector2D& point) const { return cellKey(cellCoord(point.x()), cellCoord(point.y())); }
+    template <typename Visitor>
+    void forEachNearbyCell(const QVector2D& point, Visitor&& visit) const;
+    int nearestInCells(const QVector2D& point) const;
+    void unlinkFromCell(int vertex);
+
+    const Document& document;     // Not owned; outlives the topology
+    float weldTolerance;
+    float cellWidth;              // Hash cell size, a multiple of the tolerance
+    quint64 syncedVersion;        // Document version the table reflects
+    bool tableValid;
+    std::vector<const DocumentChange*> changes;
+
+    std::vector<Vertex> vertices;
+    std::vector<int> freeVertices;
+    std::unordered_map<uint64_t, int> cells;  // Bucket key -> first vertex
+    std::vector<int> endVertices;             // Vertex per line end, -1 if detached
+    std::vector<int> nextEnds;                // Next end at the same vertex, -1 ends the list
+    std::vector<int> staleLines;              // Lines to attach once a batch of changes is replayed
+
+    // Query scratch
+    std::vector<int> pending;
+    std::vector<char> visited;
+};
+
+#endif // TOPOLOGY_H
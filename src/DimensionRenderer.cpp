@@ -0,0 +1,147 @@
+#include "DimensionRenderer.h"
+#include <cstddef>
+
+namespace {
+
+const char* dimensionVertexShader = R"(
+#version 120
+uniform float worldPerPixel;
+attribute vec2 position;
+attribute vec2 pixelOffset;
+void main()
+{
+    gl_Position = gl_ModelViewProjectionMatrix * vec4(position + pixelOffset * worldPerPixel, 0.0, 1.0);
+}
+)";
+
+const char* dimensionFragmentShader = R"(
+#version 120
+uniform vec4 color;
+void main()
+{
+    gl_FragColor = color;
+}
+)";
+
+const int positionAttribute = 0;
+const int pixelOffsetAttribute = 1;
+
+const float arrowSize = 5.0f;  // Pixels
+
+} // namespace
+
+DimensionRenderer::DimensionRenderer()
+    : vertexBuffer(QOpenGLBuffer::VertexBuffer)
+    , initialized(false)
+    , batchDirty(false)
+    , uploadedVertices(0)
+{
+}
+
+DimensionRenderer::~DimensionRenderer()
+{
+    // GL objects must be released through cleanup() while the context is current
+}
+
+void DimensionRenderer::initialize()
+{
+    initializeOpenGLFunctions();
+
+    program.addShaderFromSourceCode(QOpenGLShader::Vertex, dimensionVertexShader);
+    program.addShaderFromSourceCode(QOpenGLShader::Fragment, dimensionFragmentShader);
+    program.bindAttributeLocation("position", positionAttribute);
+    program.bindAttributeLocation("pixelOffset", pixelOffsetAttribute);
+    if (!program.link()) {
+        return;
+    }
+
+    vertexBuffer.create();
+    vertexBuffer.setUsagePattern(QOpenGLBuffer::StaticDraw);
+
+    // The batch outlives the context; upload it again
+    batchDirty = true;
+    initialized = true;
+}
+
+void DimensionRenderer::cleanup()
+{
+    vertexBuffer.destroy();
+    program.removeAllShaders();
+    initialized = false;
+}
+
+void DimensionRenderer::clear()
+{
+    batch.clear();
+    batchDirty = true;
+}
+
+void DimensionRenderer::addDimension(const QVector2D& start, const QVector2D& end, float offset)
+{
+    // Extension lines
+    batch.push_back({start.x(), start.y(), 0.0f, 0.0f});
+    batch.push_back({start.x(), start.y() + offset, 0.0f, 0.0f});
+    batch.push_back({end.x(), end.y(), 0.0f, 0.0f});
+    batch.push_back({end.x(), end.y() + offset, 0.0f, 0.0f});
+    batchDirty = true;
+
+    QVector2D direction = end - start;
+    if (direction.length() == 0) return; // Prevent division by zero
+
+    // Dimension line
+    QVector2D perp = QVector2D(-direction.y(), direction.x()).normalized();
+    QVector2D lineStart = start + perp * offset;
+    QVector2D lineEnd = end + perp * offset;
+    batch.push_back({lineStart.x(), lineStart.y(), 0.0f, 0.0f});
+    batch.push_back({lineEnd.x(), lineEnd.y(), 0.0f, 0.0f});
+
+    // Arrowheads as closed triangles pointing outwards, corners in pixels
+    QVector2D dir = direction.normalized();
+    auto addArrow = [&](const QVector2D& tip, const QVector2D& inwards) {
+        const QVector2D left = (inwards + perp) * arrowSize;
+        const QVector2D right = (inwards - perp) * arrowSize;
+        const Vertex tipVertex = {tip.x(), tip.y(), 0.0f, 0.0f};
+        const Vertex leftVertex = {tip.x(), tip.y(), left.x(), left.y()};
+        const Vertex rightVertex = {tip.x(), tip.y(), right.x(), right.y()};
+        batch.insert(batch.end(), {tipVertex, leftVertex, leftVertex, rightVertex, rightVertex, tipVertex});
+    };
+    addArrow(lineStart, dir);
+    addArrow(lineEnd, -dir);
+}
+
+void DimensionRenderer::setupAttributes()
+{
+    glEnableVertexAttribArray(positionAttribute);
+    glVertexAttribPointer(positionAttribute, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+                          reinterpret_cast<const void*>(offsetof(Vertex, x)));
+    glEnableVertexAttribArray(pixelOffsetAttribute);
+    glVertexAttribPointer(pixelOffsetAttribute, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+                          reinterpret_cast<const void*>(offsetof(Vertex, offsetX)));
+}
+
+void DimensionRenderer::draw(float worldPerPixel, const QColor& color)
+{
+    if (!initialized) return;
+
+    if (batchDirty) {
+        vertexBuffer.bind();
+        vertexBuffer.allocate(batch.data(), static_cast<int>(batch.size() * sizeof(Vertex)));
+        vertexBuffer.release();
+        uploadedVertices = batch.size();
+        batchDirty = false;
+    }
+    if (uploadedVertices == 0) return;
+
+    program.bind();
+    program.setUniformValue("worldPerPixel", worldPerPixel);
+    program.setUniformValue("color", color);
+
+    vertexBuffer.bind();
+    setupAttributes();
+    glDrawArrays(GL_LINES, 0, static_cast<GLsizei>(uploadedVertices));
+    glDisableVertexAttribArray(positionAttribute);
+    glDisableVertexAttribArray(pixelOffsetAttribute);
+    vertexBuffer.release();
+
+    program.release();
+}
@@ -0,0 +1,174 @@
+#include "Document.h"
+#include <algorithm>
+
+namespace {
+
+// Consumers normally sync every frame, so a short log is plenty; anything
+// older falls back to a full resync
+const size_t maxLoggedChanges = 64;
+
+} // namespace
+
+Document::Document()
+    : currentVersion(0)
+{
+}
+
+void Document::record(DocumentChange change)
+{
+    change.version = ++currentVersion;
+
+    // A reset makes every earlier entry irrelevant
+    if (change.type == DocumentChange::LinesReset) {
+        changeLog.clear();
+    }
+    changeLog.push_back(std::move(change));
+    while (changeLog.size() > maxLoggedChanges) {
+        changeLog.pop_front();
+    }
+}
+
+std::vector<std::pair<size_t, size_t>> Document::toRanges(std::vector<int> indices, size_t limit)
+{
+    // Selections arrive already sorted
+    if (!std::is_sorted(indices.begin(), indices.end())) {
+        std::sort(indices.begin(), indices.end());
+    }
+
+    std::vector<std::pair<size_t, size_t>> ranges;
+    for (int index : indices) {
+        if (index < 0 || static_cast<size_t>(index) >= limit) continue;
+
+        size_t i = static_cast<size_t>(index);
+        if (!ranges.empty() && ranges.back().second >= i) {
+            ranges.back().second = std::max(ranges.back().second, i + 1);
+        } else {
+            ranges.emplace_back(i, i + 1);
+        }
+    }
+    return ranges;
+}
+
+EntityHandle Document::addLine(const Line& line)
+{
+    lineData.push_back(line);
+    EntityHandle handle = handles.push_back();
+
+    DocumentChange change;
+    change.type = DocumentChange::LinesAdded;
+    change.geometryChanged = true;
+    change.ranges.emplace_back(lineData.size() - 1, lineData.size());
+    record(std::move(change));
+    return handle;
+}
+
+void Document::appendLines(const LineStore& newLines)
+{
+    if (newLines.empty()) return;
+
+    size_t first = lineData.size();
+    lineData.append(newLines);
+    handles.append(newLines.size());
+
+    DocumentChange change;
+    change.type = DocumentChange::LinesAdded;
+    change.geometryChanged = true;
+    change.ranges.emplace_back(first, lineData.size());
+    record(std::move(change));
+}
+
+void Document::setLines(LineStore newLines)
+{
+    lineData = std::move(newLines);
+    handles.reset(lineData.size());
+
+    DocumentChange change;
+    change.type = DocumentChange::LinesReset;
+    change.geometryChanged = true;
+    record(std::move(change));
+}
+
+void Document::clear()
+{
+    setLines({});
+}
+
+void Document::moveLines(const std::vector<int>& indices, const QVector2D& delta)
+{
+    DocumentChange change;
+    change.type = DocumentChange::LinesModified;
+    change.geometryChanged = true;
+    change.ranges = toRanges(indices, lineData.size());
+    if (change.ranges.empty()) return;
+
+    for (const auto& range : change.ranges) {
+        for (size_t i = range.first; i < range.second; ++i) {
+            lineData.translate(i, delta.x(), delta.y());
+        }
+    }
+    record(std::move(change));
+}
+
+void Document::setLinesColor(const std::vector<int>& indices, const QColor& color)
+{
+    DocumentChange change;
+    change.type = DocumentChange::LinesModified;
+    change.geometryChanged = false;
+    change.ranges = toRanges(indices, lineData.size());
+    if (change.ranges.empty()) return;
+
+    const QRgb rgba = color.rgba();
+    for (const auto& range : change.ranges) {
+        for (size_t i = range.first; i < range.second; ++i) {
+            lineData.setColor(i, rgba);
+        }
+    }
+    record(std::move(change));
+}
+
+void Document::replaceGeometry(const std::vector<int>& sortedIndices, const LineStore& newLines)
+{
+    DocumentChange change;
+    change.type = DocumentChange::LinesModified;
+    change.geometryChanged = true;
+    change.ranges = toRanges(sortedIndices, lineData.size());
+    if (change.ranges.empty()) return;
+
+    for (size_t k = 0; k < sortedIndices.size() && k < newLines.size(); ++k) {
+        const size_t i = static_cast<size_t>(sortedIndices[k]);
+        if (i >= lineData.size()) continue;
+        lineData.setGeometry(i, newLines.x0(k), newLines.y0(k), newLines.x1(k), newLines.y1(k));
+    }
+    record(std::move(change));
+}
+
+void Document::eraseLines(const std::vector<int>& indices)
+{
+    DocumentChange change;
+    change.type = DocumentChange::LinesRemoved;
+    change.geometryChanged = true;
+    for (const auto& range : toRanges(indices, lineData.size())) {
+        for (size_t i = range.first; i < range.second; ++i) {
+            change.removed.push_back(static_cast<int>(i));
+        }
+    }
+    if (change.removed.empty()) return;
+
+    lineData.eraseSorted(change.removed);
+    handles.eraseSorted(change.removed);
+    record(std::move(change));
+}
+
+bool Document::changesSince(quint64 sinceVersion, std::vector<const DocumentChange*>& out) const
+{
+    out.clear();
+    if (sinceVersion == currentVersion) return true;
+    if (changeLog.empty() || changeLog.front().version > sinceVersion + 1) return false;
+
+    for (const DocumentChange& change : changeLog) {
+        if (change.version > sinceVersion) {
+            out.push_back(&change);
+        }
+    }
+    return true;
+}
@@ -1,8 +1,248 @@
 #include "DxfHandler.h"
+#include <QFile>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <condition_variable>
+#include <mutex>
+#include <cstring>
 #include <fstream>
-#include <iomanip>
+#include <string>
+#include <string_view>
+#include <thread>
 
-bool DxfHandler::saveDxf(const QString& filename, const std::vector<Line>& lines) {
+namespace {
+
+// One group code / value pair; the value points into the loaded buffer
+struct DxfPair {
+    int code = -1;
+    std::string_view value;
+};
+
+std::string_view trimmed(std::string_view text)
+{
+    size_t first = 0;
+    size_t last = text.size();
+    while (first < last && (text[first] == ' ' || text[first] == '\t')) ++first;
+    while (last > first && (text[last - 1] == ' ' || text[last - 1] == '\t' || text[last - 1] == '\r')) --last;
+    return text.substr(first, last - first);
+}
+
+// from_chars rejects a leading '+', which some exporters write. The whole
+// field must be the number; "1F" or "10 20" is a failed parse, not 1 or 10.
+template <typename T>
+bool parseNumber(std::string_view text, T& out)
+{
+    text = trimmed(text);
+    if (!text.empty() && text.front() == '+') text.remove_prefix(1);
+
+    T value;
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (result.ec != std::errc() || result.ptr != text.data() + text.size()) return false;
+    out = value;
+    return true;
+}
+
+// Walks an ASCII DXF buffer as group-code/value line pairs without copying.
+// Handles LF and CRLF endings and codes padded with spaces.
+class DxfTokenizer
+{
+public:
+    DxfTokenizer(const char* data, size_t size) : pos(data), end(data + size) {}
+
+    const char* position() const { return pos; }
+
+    bool next(DxfPair& pair)
+    {
+        if (pos >= end) return false;
+
+        int code;
+        if (!parseNumber(readLine(), code)) return false;  // Out of sync; stop
+        pair.code = code;
+        pair.value = readLine();
+        if (!pair.value.empty() && pair.value.back() == '\r') pair.value.remove_suffix(1);
+        return true;
+    }
+
+private:
+    std::string_view readLine()
+    {
+        const char* start = pos;
+        const char* newline = static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+        const char* lineEnd = newline ? newline : end;
+        pos = newline ? newline + 1 : end;
+        return std::string_view(start, lineEnd - start);
+    }
+
+    const char* pos;
+    const char* end;
+};
+
+// Size of one parse job; small enough that a streamed load shows
+// progress often, large enough to keep the per-job overhead negligible
+const size_t chunkBytes = 1 << 20;
+
+const char* nextLine(const char* pos, const char* end)
+{
+    const char* newline = static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+    return newline ? newline + 1 : end;
+}
+
+// Pairs read past a candidate entity boundary to confirm it is one
+const int boundaryCheckPairs = 8;
+
+// Text of the line from 'pos' to 'next' (as returned by nextLine), without
+// its terminator
+std::string_view lineText(const char* pos, const char* next)
+{
+    if (next > pos && next[-1] == '\n') --next;
+    return trimmed(std::string_view(pos, next - pos));
+}
+
+// First line starting after 'pos' that is certainly a group code 0; 'pos'
+// must be past the start of the buffer. A "0" line could also be a value
+// (layer 0, for instance), but a value is always followed by a numeric
+// group code, while code 0 is followed by a name. The pairs after the
+// candidate must read as code/value pairs too, so a cut never lands
+// between a code and its value.
+const char* nextEntityBoundary(const char* pos, const char* end)
+{
+    // Starting mid-line, the tail of "100" would read as a "0" line
+    if (pos < end && pos[-1] != '\n') pos = nextLine(pos, end);
+
+    while (pos < end) {
+        const char* valueStart = nextLine(pos, end);
+        if (lineText(pos, valueStart) == "0") {
+            std::string_view value = lineText(valueStart, nextLine(valueStart, end));
+            int code;
+            if (!value.empty() && !parseNumber(value, code)) {
+                DxfTokenizer tokenizer(pos, static_cast<size_t>(end - pos));
+                DxfPair pair;
+                int checked = 0;
+                while (checked < boundaryCheckPairs && tokenizer.position() < end && tokenizer.next(pair)) {
+                    ++checked;
+                }
+                if (checked == boundaryCheckPairs || tokenizer.position() >= end) {
+                    return pos;
+                }
+            }
+        }
+        pos = valueStart;
+    }
+    return end;
+}
+
+// Walks the sections before ENTITIES, picking up $EXTMIN/$EXTMAX on the
+// way. Returns the offset just past the "2 / ENTITIES" pair, or null if
+// there is none.
+const char* scanHeader(const char* data, size_t size, DxfExtents& extents)
+{
+    DxfTokenizer tokenizer(data, size);
+    DxfPair pair;
+    std::string_view variable;
+    bool hasMin = false, hasMax = false;
+    float minX = 0, minY = 0, maxX = 0, maxY = 0;
+
+    while (tokenizer.next(pair)) {
+        if (pair.code == 2 && trimmed(pair.value) == "ENTITIES") {
+            // Empty drawings carry inverted extents (1e20 / -1e20)
+            extents.valid = hasMin && hasMax && minX <= maxX && minY <= maxY;
+            extents.min = QVector2D(minX, minY);
+            extents.max = QVector2D(maxX, maxY);
+            return tokenizer.position();
+        }
+
+        if (pair.code == 9) {
+            variable = trimmed(pair.value);
+        } else if (pair.code == 0) {
+            variable = std::string_view();
+        } else if (variable == "$EXTMIN") {
+            if (pair.code == 10) hasMin = parseNumber(pair.value, minX);
+            else if (pair.code == 20) hasMin = hasMin && parseNumber(pair.value, minY);
+        } else if (variable == "$EXTMAX") {
+            if (pair.code == 10) hasMax = parseNumber(pair.value, maxX);
+            else if (pair.code == 20) hasMax = hasMax && parseNumber(pair.value, maxY);
+        }
+    }
+    return nullptr;
+}
+
+// Runs produce(i) for every i in [0, count) on a pool of threads and hands
+// each result to consume(i, result) on the calling thread, strictly in
+// index order. consume returns false to stop; returns false if stopped.
+template <typename Result, typename Produce, typename Consume>
+bool runOrdered(size_t count, Produce produce, Consume consume)
+{
+    if (count == 1) {
+        Result result = produce(0);
+        return consume(0, result);
+    }
+
+    std::vector<Result> results(count);
+    std::vector<char> done(count, 0);
+    std::mutex mutex;
+    std::condition_variable finished;
+    std::atomic<size_t> next(0);
+    std::atomic<bool> stopped(false);
+
+    auto work = [&]() {
+        for (size_t i = next++; i < count && !stopped; i = next++) {
+            Result result = produce(i);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            results[i] = std::move(result);
+            done[i] = 1;
+            finished.notify_one();
+        }
+    };
+
+    size_t workerCount = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), count);
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < workerCount; ++i) {
+        workers.emplace_back(work);
+    }
+
+    for (size_t i = 0; i < count && !stopped; ++i) {
+        Result result;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            finished.wait(lock, [&]() { return done[i] != 0; });
+            result = std::move(results[i]);
+        }
+        if (!consume(i, result)) {
+            stopped = true;
+        }
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    return !stopped;
+}
+
+// Lines formatted per job when saving
+const size_t saveChunkLines = 1 << 16;
+
+void appendNumber(std::string& out, float value, int precision)
+{
+    char buffer[64];
+    auto result = precision < 0
+        ? std::to_chars(buffer, buffer + sizeof(buffer), value)
+        : std::to_chars(buffer, buffer + sizeof(buffer), static_cast<double>(value), std::chars_format::fixed, precision);
+    out.append(buffer, result.ptr);
+}
+
+void appendNumber(std::string& out, int value)
+{
+    char buffer[16];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr);
+}
+
+} // namespace
+
+bool DxfHandler::saveDxf(const QString& filename, const LineStore& lines, int precision) {
     std::ofstream file(filename.toStdString());
     if (!file) return false;
 
@@ -10,75 +250,170 @@ bool DxfHandler::saveDxf(const QString& filename, const std::vector<Line>& lines
     file << "0\nSECTION\n2\nHEADER\n0\nENDSEC\n";
     file << "0\nSECTION\n2\nENTITIES\n";
 
-    // Write lines
-    for (const Line& line : lines) {
-        file << "0\nLINE\n";
-        file << "8\n0\n";  // Layer 0
-        file << "62\n" << DxfHandler::qColorToAcadColor(line.color) << "\n";  // Color number
-        file << "10\n" << std::fixed << std::setprecision(6) << line.start.x() << "\n";
-        file << "20\n" << line.start.y() << "\n";
-        file << "30\n0.0\n";
-        file << "11\n" << line.end.x() << "\n";
-        file << "21\n" << line.end.y() << "\n";
-        file << "31\n0.0\n";
+    // Write lines: chunks are formatted into their own buffers in parallel
+    // and written in order with one call each
+    const size_t chunkCount = (lines.size() + saveChunkLines - 1) / saveChunkLines;
+    auto format = [&](size_t chunk) {
+        size_t first = chunk * saveChunkLines;
+        size_t last = std::min(first + saveChunkLines, lines.size());
+
+        std::string out;
+        out.reserve((last - first) * 160);
+        // Drawings use few colours; map each run of equal ones once
+        QRgb lastRgba = 0;
+        int lastColor = -1;
+        for (size_t i = first; i < last; ++i) {
+            if (lastColor < 0 || lines.rgba(i) != lastRgba) {
+                lastRgba = lines.rgba(i);
+                lastColor = DxfHandler::qColorToAcadColor(lines.color(i));
+            }
+            out += "0\nLINE\n";
+            out += "8\n0\n";  // Layer 0
+            out += "62\n";
+            appendNumber(out, lastColor);  // Color number
+            out += "\n10\n";
+            appendNumber(out, lines.x0(i), precision);
+            out += "\n20\n";
+            appendNumber(out, lines.y0(i), precision);
+            out += "\n30\n0.0\n";
+            out += "11\n";
+            appendNumber(out, lines.x1(i), precision);
+            out += "\n21\n";
+            appendNumber(out, lines.y1(i), precision);
+            out += "\n31\n0.0\n";
+        }
+        return out;
+    };
+    auto write = [&](size_t, const std::string& out) {
+        file.write(out.data(), static_cast<std::streamsize>(out.size()));
+        return static_cast<bool>(file);
+    };
+    if (chunkCount > 0 && !runOrdered<std::string>(chunkCount, format, write)) {
+        return false;
     }
 
     // Write footer
     file << "0\nENDSEC\n0\nEOF\n";
-    return true;
+    return static_cast<bool>(file);
 }
 
-bool DxfHandler::loadDxf(const QString& filename, std::vector<Line>& lines) {
-    std::ifstream file(filename.toStdString());
-    if (!file) return false;
-
+bool DxfHandler::loadDxf(const QString& filename, LineStore& lines, DxfLoadStats* stats) {
     lines.clear();
-    std::string line;
+
+    DxfLoadCallbacks callbacks;
+    callbacks.batch = [&](LineStore& batch, qint64, qint64) {
+        if (lines.empty()) {
+            std::swap(lines, batch);
+        } else {
+            lines.append(batch);
+        }
+        return true;
+    };
+    return loadDxf(filename, callbacks, stats);
+}
+
+bool DxfHandler::loadDxf(const QString& filename, const DxfLoadCallbacks& callbacks, DxfLoadStats* stats) {
+    QElapsedTimer timer;
+    timer.start();
+
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+
+    // Map the whole file and tokenize it in place; fall back to a single
+    // read where mapping is not available
+    const qint64 size = file.size();
+    QByteArray fallback;
+    const char* data = nullptr;
+    if (size > 0) {
+        data = reinterpret_cast<const char*>(file.map(0, size));
+        if (!data) {
+            fallback = file.readAll();
+            data = fallback.constData();
+        }
+    }
+    const char* fileEnd = data ? data + size : nullptr;
+
+    DxfExtents extents;
+    const char* entities = data ? scanHeader(data, static_cast<size_t>(size), extents) : nullptr;
+    if (extents.valid && callbacks.extents) {
+        callbacks.extents(extents);
+    }
+
+    // Everything up to the ENTITIES section (header, tables, blocks) is
+    // parsed as one chunk. The section itself is cut at entity boundaries
+    // into fixed-size chunks; no entity spans a cut, so parsing the chunks
+    // independently gives the same lines as one pass.
+    std::vector<const char*> cuts{data};
+    if (entities) {
+        cuts.push_back(entities);
+        while (static_cast<size_t>(fileEnd - cuts.back()) > chunkBytes) {
+            const char* cut = nextEntityBoundary(cuts.back() + chunkBytes, fileEnd);
+            if (cut >= fileEnd) break;
+            cuts.push_back(cut);
+        }
+    }
+    cuts.push_back(fileEnd);
+
+    // Workers parse chunks while this thread hands the finished ones to
+    // the callback strictly in file order
+    size_t entityCount = 0;
+    auto parse = [&](size_t chunk) {
+        LineStore parsed;
+        parseLines(cuts[chunk], static_cast<size_t>(cuts[chunk + 1] - cuts[chunk]), parsed);
+        return parsed;
+    };
+    auto deliver = [&](size_t chunk, LineStore& batch) {
+        entityCount += batch.size();
+        return !callbacks.batch || callbacks.batch(batch, static_cast<qint64>(cuts[chunk + 1] - data), size);
+    };
+    const bool completed = runOrdered<LineStore>(cuts.size() - 1, parse, deliver);
+
+    if (stats) {
+        stats->bytes = size;
+        stats->elapsedNs = timer.nsecsElapsed();
+        stats->entities = entityCount;
+    }
+    return completed;
+}
+
+void DxfHandler::parseLines(const char* data, size_t size, LineStore& lines) {
+    DxfTokenizer tokenizer(data, size);
+    DxfPair pair;
+    bool inLine = false;
     float x1 = 0, y1 = 0, x2 = 0, y2 = 0;
     int colorNum = 7;  // Default white
 
-    while (std::getline(file, line)) {
-        if (line == "0") {
-            std::getline(file, line);
-            if (line == "LINE") {
-                // Reset values for new line
+    auto finishLine = [&]() {
+        if (inLine) {
+            lines.push_back(x1, y1, x2, y2, DxfHandler::acadColorToQColor(colorNum).rgba());
+            inLine = false;
+        }
+    };
+
+    while (tokenizer.next(pair)) {
+        if (pair.code == 0) {
+            // Group code 0 ends the current entity and names the next one
+            finishLine();
+            if (trimmed(pair.value) == "LINE") {
+                inLine = true;
                 x1 = y1 = x2 = y2 = 0;
                 colorNum = 7;
-                
-                // Read all line parameters
-                std::string code;
-                while (std::getline(file, code)) {
-                    if (code == "0") break;  // End of entity
-                    
-                    std::string value;
-                    std::getline(file, value);
-                    
-                    try {
-                        if (code == "10") x1 = std::stof(value);
-                        else if (code == "20") y1 = std::stof(value);
-                        else if (code == "11") x2 = std::stof(value);
-                        else if (code == "21") y2 = std::stof(value);
-                        else if (code == "62") colorNum = std::stoi(value);
-                    } catch (...) {
-                        // Handle conversion errors
-                        continue;
-                    }
-                }
-                
-                // Create line with correct color
-                QColor color = DxfHandler::acadColorToQColor(colorNum);
-                lines.push_back(Line(QVector2D(x1, y1), QVector2D(x2, y2), color));
-
-                // If we broke out due to new entity, push the "0" back
-                if (code == "0") {
-                    line = code;
-                    continue;
-                }
             }
+            continue;
         }
-    }
+        if (!inLine) continue;
 
-    return true;
+        // Malformed numbers leave the previous value in place
+        switch (pair.code) {
+            case 10: parseNumber(pair.value, x1); break;
+            case 20: parseNumber(pair.value, y1); break;
+            case 11: parseNumber(pair.value, x2); break;
+            case 21: parseNumber(pair.value, y2); break;
+            case 62: parseNumber(pair.value, colorNum); break;
+            default: break;
+        }
+    }
+    finishLine();
 }
 
 int DxfHandler::qColorToAcadColor(const QColor& color) {
@@ -0,0 +1,38 @@
+#include "DxfLoader.h"
+
+DxfLoader::DxfLoader(const QString& filename, QObject* parent)
+    : QObject(parent)
+    , filename(filename)
+    , cancelRequested(false)
+{
+    // Both cross the thread boundary in queued signals
+    qRegisterMetaType<LineStore>();
+    qRegisterMetaType<DxfLoadStats>();
+}
+
+void DxfLoader::run()
+{
+    int lastPercent = -1;
+
+    DxfLoadCallbacks callbacks;
+    callbacks.extents = [this](const DxfExtents& extents) {
+        emit extentsFound(extents.min, extents.max);
+    };
+    callbacks.batch = [&](LineStore& batch, qint64 bytesDone, qint64 bytesTotal) {
+        if (cancelRequested) return false;
+
+        if (!batch.empty()) {
+            emit batchLoaded(batch);
+        }
+        int percent = bytesTotal > 0 ? static_cast<int>(bytesDone * 100 / bytesTotal) : 100;
+        if (percent != lastPercent) {
+            lastPercent = percent;
+            emit progress(percent);
+        }
+        return !cancelRequested;
+    };
+
+    DxfLoadStats stats;
+    bool success = DxfHandler::loadDxf(filename, callbacks, &stats);
+    emit finished(success, cancelRequested, stats);
+}
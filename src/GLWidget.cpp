@@ -2,10 +2,13 @@
 #include <QMouseEvent>
 #include <QWheelEvent>
 #include <GL/gl.h>
-#include <QPainter>
+#include <QOpenGLFramebufferObject>
+#include <QFile>
+#include <QThread>
 #include "SnapManager.h"  // Include SnapManager implementation
 #include "Line.h"         // Include Line struct
 #include "DxfHandler.h"   // Include DxfHandler
+#include "DxfLoader.h"
 
 GLWidget::GLWidget(QWidget* parent)
     : QOpenGLWidget(parent)
@@ -20,7 +23,6 @@ GLWidget::GLWidget(QWidget* parent)
     , currentStart(0, 0)
     , currentEnd(0, 0)
     , currentMode(MODE_NONE)
-    , snapManager(nullptr)
     , pan(0, 0)
     , zoom(1.0f)
     , snapThreshold(5.0f) // Reduced from 10.0f to 5.0f for more precise snapping
@@ -35,7 +37,6 @@ GLWidget::GLWidget(QWidget* parent)
     , dimEnd(0, 0)
     , currentDimOffset(20.0f)
     , objectSelected(false)
-    , selectedObjectIndex(-1)
     , isAwaitingMoveStartPoint(false)  // Match header order
     , isAwaitingMoveEndPoint(false)   // Initialize new variable
     , isZooming(false)               // Initialize zoom state
@@ -49,26 +50,29 @@ GLWidget::GLWidget(QWidget* parent)
     setMouseTracking(true);
     setFocusPolicy(Qt::StrongFocus); // Enable key events
 
-    // Initialize SnapManager
-    snapManager = new SnapManager(snapThreshold, zoom, lines);
-    snapManager->updateSettings(snapThreshold, zoom, lines);  // Ensure initial settings are applied
-
-    // Initialize snap history timer
-    snapHistoryTimer = new QTimer(this);
-    snapHistoryTimer->setInterval(100);  // Check every 100ms
-    connect(snapHistoryTimer, &QTimer::timeout, this, [this]() {
-        if (lastSnap.isActive && (QDateTime::currentMSecsSinceEpoch() / 1000.0f - lastSnap.timestamp) > snapHistoryTimeout) {
-            clearSnapHistory();
+    // Snap queries run on their own thread against a replica of the document
+    snapThread = new QThread(this);
+    snapWorker = new SnapWorker;
+    snapWorker->moveToThread(snapThread);
+    connect(snapThread, &QThread::started, snapWorker, &SnapWorker::run);
+    connect(snapWorker, &SnapWorker::snapFound, this, &GLWidget::onSnapFound);
+    snapThread->start();
+
+    // The level of detail is rebuilt off the GUI thread; redraw the scene
+    // once it lands
+    lineRenderer.setLevelOfDetailCallback([this]() {
+        QMetaObject::invokeMethod(this, [this]() {
+            invalidateScene();
             update();
-        }
+        }, Qt::QueuedConnection);
     });
-    snapHistoryTimer->start();
 
-    // Initialize track timer
-    trackTimer = new QTimer(this);
-    trackTimer->setInterval(100);  // Check every 100ms
-    connect(trackTimer, &QTimer::timeout, this, &GLWidget::updateTrackPoints);
-    trackTimer->start();
+    // Snap history and track points expire through one single-shot timer,
+    // armed only while any of them exist
+    overlayClock.start();
+    expiryTimer = new QTimer(this);
+    expiryTimer->setSingleShot(true);
+    connect(expiryTimer, &QTimer::timeout, this, &GLWidget::expireOverlays);
 
     tempIntersection.isValid = false;
     lastSnapPoints[0] = {QVector2D(0,0), QVector2D(0,0)};
@@ -81,7 +85,20 @@ GLWidget::GLWidget(QWidget* parent)
 
 GLWidget::~GLWidget()
 {
-    delete snapManager;
+    stopLoading();
+
+    // GPU resources have to be released while our context is current
+    makeCurrent();
+    lineRenderer.cleanup();
+    dimensionRenderer.cleanup();
+    labelAtlas.cleanup();
+    delete sceneCache;
+    doneCurrent();
+
+    snapWorker->stop();
+    snapThread->quit();
+    snapThread->wait();
+    delete snapWorker;
 }
 
 void GLWidget::initializeGL()
@@ -89,8 +106,11 @@ void GLWidget::initializeGL()
     initializeOpenGLFunctions();
     glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
 
-    // Ensure SnapManager has the initial settings
-    snapManager->updateSettings(snapThreshold, zoom, lines);
+    lineRenderer.initialize();
+    lineRenderer.invalidateAll();
+    dimensionRenderer.initialize();
+    labelAtlas.initialize(font(), devicePixelRatioF());
+    dimensionsDirty = true;
 }
 
 void GLWidget::paintGL()
@@ -102,37 +122,26 @@ void GLWidget::paintGL()
     glScalef(zoom, zoom, 1.0f);
     glTranslatef(pan.x() / zoom, pan.y() / zoom, 0);
 
-    // Draw existing lines
-    for (size_t i = 0; i < lines.size(); ++i) {
-        if (std::find(selectedObjectIndices.begin(), selectedObjectIndices.end(), static_cast<int>(i)) != selectedObjectIndices.end()) {
-            // Selected lines get highlighted
-            QColor highlightColor = lines[i].color.lighter(150);
-            glColor4f(highlightColor.redF(), highlightColor.greenF(), highlightColor.blueF(), highlightColor.alphaF());
-        }
-        else {
-            // Use the line's stored color
-            glColor4f(lines[i].color.redF(), lines[i].color.greenF(), lines[i].color.blueF(), lines[i].color.alphaF());
-        }
-        glBegin(GL_LINES);
-        glVertex2f(lines[i].start.x(), lines[i].start.y());
-        glVertex2f(lines[i].end.x(), lines[i].end.y());
-        glEnd();
+    // Committed geometry comes from the cached scene image when possible,
+    // so cursor moves only pay for the overlays drawn below
+    if (updateSceneCache()) {
+        QOpenGLFramebufferObject::blitFramebuffer(nullptr, sceneCache);
+    } else {
+        drawCommittedScene();
     }
+    drawHoveredLine();
 
     // Draw ghost preview if in move mode and tracking
     if (currentMode == MODE_MOVE && ghostTracker.isTracking()) {
         renderGhostObjects();
     }
 
-    // Draw dimensions
-    glColor3f(0.0f, 1.0f, 0.0f);  // Green color for dimensions
-    for (const auto& dim : dimensions) {
-        drawDimension(dim);
-    }
+    // Draw dimensions (kept out of the scene cache)
+    drawDimensions();
 
-    // Draw snap marker using SnapManager
-    if (snapManager->isSnapActive()) {
-        snapManager->drawSnapMarker(pan, zoom);
+    // Draw the marker of the newest snap the worker delivered
+    if (currentSnap.active) {
+        SnapManager::drawSnapMarker(currentSnap.point, currentSnap.type, zoom);
     }
 
     // Draw current line if drawing
@@ -240,6 +249,111 @@ void GLWidget::paintGL()
     drawShiftSnapLines();
 }
 
+void GLWidget::drawCommittedScene()
+{
+    // Submit only the lines whose boxes reach into the view; the margin
+    // keeps lines that end right on the border
+    const QVector2D topLeft = screenToWorld(QPoint(0, 0));
+    const QVector2D bottomRight = screenToWorld(QPoint(width(), height()));
+    const float margin = 2.0f / zoom;
+    const QRectF view = QRectF(QPointF(topLeft.x(), topLeft.y()), QPointF(bottomRight.x(), bottomRight.y()))
+                            .normalized().adjusted(-margin, -margin, margin, margin);
+
+    // Contexts that cannot run the line shader get the old per-line loop
+    if (!lineRenderer.isAvailable()) {
+        selection.linesInRect(view, visibleLines);
+        drawLinesImmediate(visibleLines, -1);
+        return;
+    }
+
+    // Draw existing lines from the retained vertex buffer. Selection is a
+    // per-line flag the shader applies, so changing it only rewrites the
+    // affected rows of the attribute texture.
+    lineRenderer.sync(document);
+    lineRenderer.setSelection(selectionSet.indices());
+    lineRenderer.setHovered(-1);  // Drawn over the scene by drawHoveredLine()
+
+    // Zoomed far out, sub-pixel lines are drawn from the level-of-detail
+    // hierarchy instead of one by one, once it is up to date
+    if (lineRenderer.drawLevelOfDetail(document, 1.0f / (zoom * devicePixelRatioF()))) {
+        return;
+    }
+
+    selection.linesInRect(view, visibleLines);
+    lineRenderer.draw(visibleLines);
+}
+
+void GLWidget::drawLinesImmediate(const std::vector<int>& indices, int hovered)
+{
+    // Same colours the line shader gives: selected lines lighter, the
+    // hovered one blended halfway to white
+    const LineStore& lines = document.lines();
+    glBegin(GL_LINES);
+    for (int index : indices) {
+        QColor color = lines.color(index);
+        if (selectionSet.contains(index)) {
+            color = color.lighter(150);
+        }
+        float r = color.redF(), g = color.greenF(), b = color.blueF();
+        if (index == hovered) {
+            r = (r + 1.0f) * 0.5f;
+            g = (g + 1.0f) * 0.5f;
+            b = (b + 1.0f) * 0.5f;
+        }
+        glColor4f(r, g, b, 1.0f);
+        glVertex2f(lines.x0(index), lines.y0(index));
+        glVertex2f(lines.x1(index), lines.y1(index));
+    }
+    glEnd();
+}
+
+void GLWidget::drawHoveredLine()
+{
+    // Kept out of the committed scene so that moving the cursor from line
+    // to line only redraws this one line over the cached image
+    const int hovered = document.indexOf(hoveredObject);
+    if (hovered < 0) return;
+
+    if (lineRenderer.isAvailable()) {
+        lineRenderer.drawHovered(hovered);
+    } else {
+        drawLinesImmediate(std::vector<int>(1, hovered), hovered);
+    }
+}
+
+bool GLWidget::updateSceneCache()
+{
+    if (!QOpenGLFramebufferObject::hasOpenGLFramebufferBlit()) {
+        return false;
+    }
+
+    const QSize framebufferSize = size() * devicePixelRatioF();
+    if (!sceneCache || sceneCache->size() != framebufferSize) {
+        delete sceneCache;
+        sceneCache = new QOpenGLFramebufferObject(framebufferSize);
+        sceneCacheDirty = true;
+    }
+
+    // Document edits show up as a new version, view changes by comparing
+    // against the view the cache was rendered with
+    if (document.version() != sceneCacheVersion || pan != sceneCachePan || zoom != sceneCacheZoom) {
+        sceneCacheDirty = true;
+    }
+
+    if (sceneCacheDirty) {
+        sceneCache->bind();
+        glClear(GL_COLOR_BUFFER_BIT);
+        drawCommittedScene();
+        sceneCache->release();
+
+        sceneCachePan = pan;
+        sceneCacheZoom = zoom;
+        sceneCacheVersion = document.version();
+        sceneCacheDirty = false;
+    }
+    return true;
+}
+
 QVector2D GLWidget::snapPoint(const QVector2D& point)
 {
     // Skip snapping in delete mode
@@ -257,12 +371,13 @@ QVector2D GLWidget::snapPoint(const QVector2D& point)
         }
     }
 
-    // Update snap system with current settings
-    snapManager->updateSettings(snapThreshold, zoom, lines);
-    snapManager->updateSnap(worldPoint);
-    
-    if (snapManager->isSnapActive()) {
-        QVector2D snapPoint = snapManager->getCurrentSnapPoint();
+    // The newest snap may answer an earlier cursor position; it only
+    // counts while still within the snap radius of this one
+    const bool snapped = currentSnap.active &&
+                         (currentSnap.point - worldPoint).length() < snapThreshold * 5.0f / zoom;
+
+    if (snapped) {
+        QVector2D snapPoint = currentSnap.point;
         
         // Update tracking with snap point
         updateTrackLine(snapPoint);
@@ -316,8 +431,8 @@ QVector2D GLWidget::snapPoint(const QVector2D& point)
     }
 
     // Update tracking with new point if it's a valid snap
-    if (snapManager->isSnapActive()) {
-        updateTrackingPoint(snapManager->getCurrentSnapPoint());
+    if (snapped) {
+        updateTrackingPoint(currentSnap.point);
     }
     
     return point;
@@ -327,8 +442,9 @@ void GLWidget::updateSnapHistory(const QVector2D& snapPoint, const QVector2D& di
 {
     lastSnap.point = snapPoint;
     lastSnap.direction = dir;
-    lastSnap.timestamp = QDateTime::currentMSecsSinceEpoch() / 1000.0f;
+    lastSnap.timestamp = overlayTime();
     lastSnap.isActive = true;
+    scheduleExpiry();
 }
 
 void GLWidget::clearSnapHistory()
@@ -415,6 +531,7 @@ void GLWidget::mousePressEvent(QMouseEvent* event)
     clearTrackLines();  // Clear track lines on new action
 
     QVector2D worldPos = screenToWorld(event->pos());
+    snapExactly(worldPos);
     QVector2D snappedPos = snapPoint(worldPos);
 
     if (event->button() == Qt::MiddleButton) {
@@ -483,9 +600,10 @@ void GLWidget::mousePressEvent(QMouseEvent* event)
                 isDrawing = true;
                 // Reset move-related states
                 isDragging = false;
-                selectedObjectIndices.clear();
+                selectionSet.clear();
                 objectSelected = false;
-                selectedObjectIndex = -1;
+                selectedObject = EntityHandle();
+                invalidateScene();
             } else {
                 // Second point - complete the line
                 hasFirstPoint = false;
@@ -538,13 +656,41 @@ void GLWidget::mouseMoveEvent(QMouseEvent* event)
     }
 
     QVector2D worldPos = screenToWorld(event->pos());
-    
-    // Update snap settings before getting snapped position
-    snapManager->updateSettings(snapThreshold, zoom, lines);
-    QVector2D snappedPos = snapPoint(worldPos);
 
-    // Update coordinates and snap markers
-    snapManager->updateSnap(worldPos);
+    // The worker answers through onSnapFound; until then the newest snap
+    // it delivered stands in
+    cursorWorld = worldPos;
+    snapWorker->requestSnap(document, snapQuery(worldPos));
+    updateCursor(worldPos);
+
+    // Handle selection rectangle
+    if (isSelectingRectangle) {
+        selectionEndPos = event->pos();
+        // Determine crossing selection mode: 
+        // If dragging right to left OR bottom to top = crossing selection
+        isCrossingSelection = (selectionEndPos.x() < selectionStartPos.x()) || 
+                            (selectionEndPos.y() < selectionStartPos.y());
+        selectionRect = QRect(selectionStartPos, selectionEndPos).normalized();
+        update();
+    }
+
+    // Highlight the line a click would pick
+    EntityHandle hovered;
+    if (!isDrawing && !isSelectingRectangle && !ghostTracker.isTracking() &&
+        (currentMode == MODE_NONE || currentMode == MODE_MOVE || currentMode == MODE_DELETE)) {
+        const int index = selection.pickLine(worldPos, 10.0f / zoom);
+        if (index >= 0) {
+            hovered = document.handleAt(index);
+        }
+    }
+    hoveredObject = hovered;
+
+    update();
+}
+
+void GLWidget::updateCursor(const QVector2D& worldPos)
+{
+    QVector2D snappedPos = snapPoint(worldPos);
     updateCoordinates(snappedPos);
 
     // Update line preview while drawing
@@ -566,21 +712,63 @@ void GLWidget::mouseMoveEvent(QMouseEvent* event)
         }
         update();
     }
+}
 
-    // Handle selection rectangle
-    if (isSelectingRectangle) {
-        selectionEndPos = event->pos();
-        // Determine crossing selection mode: 
-        // If dragging right to left OR bottom to top = crossing selection
-        isCrossingSelection = (selectionEndPos.x() < selectionStartPos.x()) || 
-                            (selectionEndPos.y() < selectionStartPos.y());
-        selectionRect = QRect(selectionStartPos, selectionEndPos).normalized();
-        update();
-    }
+void GLWidget::onSnapFound(const SnapResult& result)
+{
+    // Answers to requests older than the one shown are of no use
+    if (result.sequence <= currentSnap.sequence) return;
+
+    currentSnap = result;
+    updateCursor(cursorWorld);
+    update();
+}
+
+void GLWidget::snapExactly(const QVector2D& worldPos)
+{
+    // Clicks act on the snap at the click point, not on whatever the
+    // worker last delivered, so wait for it
+    currentSnap = snapWorker->snapNow(document, snapQuery(worldPos));
+    cursorWorld = worldPos;
+}
+
+SnapQuery GLWidget::snapQuery(const QVector2D& worldPos) const
+{
+    SnapQuery query;
+    query.point = worldPos;
+    query.snapThreshold = snapThreshold;
+    query.zoom = zoom;
+    query.modes = activeSnapModes;
+
+    // Perpendicular snaps are measured from the start of the line being drawn
+    query.hasReferencePoint = isDrawing && hasFirstPoint;
+    query.referencePoint = currentStart;
+    return query;
+}
 
+void GLWidget::setSnapModes(unsigned modes)
+{
+    activeSnapModes = modes & SnapManager::AllSnapModes;
+    clearSnap();
+    snapWorker->requestSnap(document, snapQuery(cursorWorld));
     update();
 }
 
+void GLWidget::setWeldEndpoints(bool enabled)
+{
+    weldEndpoints = enabled;
+    if (!enabled) {
+        topology.clear();
+    }
+}
+
+void GLWidget::clearSnap()
+{
+    // Also drops the answers still on their way
+    currentSnap = SnapResult();
+    currentSnap.sequence = snapWorker->lastSequence();
+}
+
 // Remove or comment out isDragging related code in mouseReleaseEvent
 void GLWidget::mouseReleaseEvent(QMouseEvent* event)
 {
@@ -590,16 +778,17 @@ void GLWidget::mouseReleaseEvent(QMouseEvent* event)
     }
 
     QVector2D worldPos = screenToWorld(event->pos());
+    snapExactly(worldPos);
     QVector2D snappedPos = snapPoint(worldPos);
 
     if (event->button() == Qt::LeftButton) {
         if (isSelectingRectangle) {
             isSelectingRectangle = false;
-            performRectangleSelection(selectionRect);
+            performRectangleSelection(selectionRect, event->modifiers());
             selectionRect = QRect();
             
             // If in delete mode, delete selected objects immediately
-            if (currentMode == MODE_DELETE && !selectedObjectIndices.empty()) {
+            if (currentMode == MODE_DELETE && !selectionSet.empty()) {
                 deleteSelectedObjects();
                 currentCommand = "Objects deleted. Select more objects to delete or ESC to exit";
                 emit commandChanged(currentCommand);
@@ -646,8 +835,9 @@ void GLWidget::wheelEvent(QWheelEvent* event)
     QVector2D newWorld = screenToWorld(event->position().toPoint());
     pan += (newWorld - oldWorld) * zoom;
 
-    float worldThreshold = snapThreshold / zoom;
-    snapManager->updateSettings(worldThreshold, zoom, lines);
+    // The snap radius is in pixels, so ask again at the new zoom
+    clearSnap();
+    snapWorker->requestSnap(document, snapQuery(mouseWorld));
     
     update();
 }
@@ -671,6 +861,11 @@ void GLWidget::keyPressEvent(QKeyEvent* event)
         processNumericInput("Backspace");
     }
     else if (event->key() == Qt::Key_Escape) {
+        if (dxfLoader) {
+            // Keeps the lines loaded so far, or the previous drawing if
+            // none arrived yet; onDxfFinished reports it
+            dxfLoader->cancel();
+        }
         if (currentMode == MODE_DELETE) {
             // Exit delete mode and update button state
             setCurrentMode(MODE_NONE);
@@ -687,9 +882,15 @@ void GLWidget::keyPressEvent(QKeyEvent* event)
             startDeleteMode();
         }
     }
+    else if (event->key() == Qt::Key_I && (event->modifiers() & Qt::ControlModifier)) {
+        invertSelection();
+    }
+    else if (event->key() == Qt::Key_L && (event->modifiers() & Qt::ControlModifier)) {
+        selectConnected();
+    }
     if (event->key() == Qt::Key_Shift) {
-        if (snapManager) {
-            QVector2D currentPoint = snapManager->getCurrentSnapPoint();
+        if (currentSnap.active) {
+            QVector2D currentPoint = currentSnap.point;
             if (!currentPoint.isNull()) {  // Check if we have a valid snap point
                 isShiftSnapping = true;
                 currentShiftSnap = 0;
@@ -714,12 +915,11 @@ void GLWidget::addLine(const QVector2D& start, const QVector2D& end)
 {
     // Apply ortho constraint when adding the final line
     QVector2D finalEnd = orthoMode ? constrainToOrtho(start, end) : end;
-    lines.push_back({start, finalEnd, currentColor});  // Use current color when adding line
-    
-    // Update snap system with new line
-    if (snapManager) {
-        snapManager->updateSettings(snapThreshold, zoom, lines);
+    if (weldEndpoints) {
+        document.addLine({topology.weld(start), topology.weld(finalEnd), currentColor});
+        return;
     }
+    document.addLine({start, finalEnd, currentColor});  // Use current color when adding line
 }
 
 void GLWidget::setStatusBar(QStatusBar* statusBar)
@@ -733,7 +933,10 @@ void GLWidget::updateCommandStatus()
     if (!m_statusBar) return;
     
     QString status;
-    if (currentMode == MODE_DELETE) {
+    if (dxfLoader) {
+        status = QString("Loading %1: %2% (ESC to cancel)").arg(dxfLoader->fileName()).arg(loadPercent);
+    }
+    else if (currentMode == MODE_DELETE) {
         status = "Delete Mode: Select objects to delete (ESC to exit)";
     }
     else if (currentMode == MODE_MOVE) {
@@ -861,8 +1064,9 @@ void GLWidget::applyLengthConstraint(QVector2D& end)
 
 QVector2D GLWidget::findMidPoint(const QVector2D& point)
 {
-    for (const auto& line : lines) {
-        QVector2D mid = (line.start + line.end) * 0.5f;
+    const LineStore& lines = document.lines();
+    for (size_t i = 0; i < lines.size(); ++i) {
+        QVector2D mid = (lines.start(i) + lines.end(i)) * 0.5f;
         if ((mid - point).length() < snapThreshold / zoom) {
             return mid;
         }
@@ -877,9 +1081,7 @@ void GLWidget::startLineDrawing()
     currentCommand = "Line";
     
     // Ensure snap system is ready for line drawing
-    if (snapManager) {
-        snapManager->updateSettings(snapThreshold, zoom, lines);
-    }
+    clearSnap();
     
     updateCommandStatus();
     update();
@@ -903,74 +1105,31 @@ void GLWidget::resetDrawingState()
     hasLengthConstraint = false;
 }
 
-void GLWidget::drawDimension(const Dimension& dim)
+void GLWidget::drawDimensions()
 {
-    // Draw extension lines
-    glBegin(GL_LINES);
-    glVertex2f(dim.start.x(), dim.start.y());
-    glVertex2f(dim.start.x(), dim.start.y() + dim.offset);
-    glVertex2f(dim.end.x(), dim.end.y());
-    glVertex2f(dim.end.x(), dim.end.y() + dim.offset);
-    glEnd();
-
-    // Draw dimension line
-    QVector2D direction = dim.end - dim.start;
-    if (direction.length() == 0) return; // Prevent division by zero
-    QVector2D perp = QVector2D(-direction.y(), direction.x()).normalized();
-    QVector2D dimLineStart = QVector2D(dim.start.x(), dim.start.y()) + perp * dim.offset;
-    QVector2D dimLineEnd = QVector2D(dim.end.x(), dim.end.y()) + perp * dim.offset;
-
-    glBegin(GL_LINES);
-    glVertex2f(dimLineStart.x(), dimLineStart.y());
-    glVertex2f(dimLineEnd.x(), dimLineEnd.y());
-    glEnd();
-
-    // Draw arrows
-    float arrowSize = 5.0f / zoom;
-    QVector2D dir = direction.normalized();
-    QVector2D perpOffset = perp * arrowSize;
-
-    // Arrow 1 at dimLineStart
-    glBegin(GL_LINE_LOOP);
-    glVertex2f(dimLineStart.x(), dimLineStart.y());
-    glVertex2f(dimLineStart.x() + dir.x() * arrowSize + perpOffset.x(),
-               dimLineStart.y() + dir.y() * arrowSize + perpOffset.y());
-    glVertex2f(dimLineStart.x() + dir.x() * arrowSize - perpOffset.x(),
-               dimLineStart.y() + dir.y() * arrowSize - perpOffset.y());
-    glEnd();
+    // Moving to a screen with another pixel ratio needs sharper or coarser glyphs
+    if (labelAtlas.devicePixelRatio() != devicePixelRatioF()) {
+        labelAtlas.initialize(font(), devicePixelRatioF());
+        dimensionsDirty = true;
+    }
 
-    // Arrow 2 at dimLineEnd
-    glBegin(GL_LINE_LOOP);
-    glVertex2f(dimLineEnd.x(), dimLineEnd.y());
-    glVertex2f(dimLineEnd.x() - dir.x() * arrowSize + perpOffset.x(),
-               dimLineEnd.y() - dir.y() * arrowSize + perpOffset.y());
-    glVertex2f(dimLineEnd.x() - dir.x() * arrowSize - perpOffset.x(),
-               dimLineEnd.y() - dir.y() * arrowSize - perpOffset.y());
-    glEnd();
+    if (dimensionsDirty) {
+        dimensionRenderer.clear();
+        labelAtlas.clear();
+        for (Dimension& dim : dimensions) {
+            dimensionRenderer.addDimension(dim.start, dim.end, dim.offset);
+            if (dim.start == dim.end) continue;
+            if (!labelAtlas.isCurrent(dim.label)) {
+                labelAtlas.layout(dim.text, dim.label);
+            }
+            labelAtlas.addText(dim.labelAnchor, dim.label);
+        }
+        dimensionsDirty = false;
+    }
 
-    // Draw measurement text centered on the dimension line
-    QVector2D center = (dimLineStart + dimLineEnd) * 0.5f;
-    renderText(center.x(), center.y(), dim.text);  // Position text on the dimension line
-}
-
-void GLWidget::renderText(float x, float y, const QString& text)
-{
-    QPainter painter(this);
-    painter.setPen(Qt::green);
-    painter.setRenderHint(QPainter::TextAntialiasing);
-    
-    // Convert to screen coordinates
-    QVector2D screenPos = worldToScreen(QVector2D(x, y));
-    
-    // Center the text using QRectF and alignment flags
-    QFontMetrics fm = painter.fontMetrics();
-    int textWidth = fm.horizontalAdvance(text);
-    int textHeight = fm.height();
-    
-    QRectF rect(screenPos.x() - textWidth / 2, screenPos.y() - textHeight / 2, textWidth, textHeight);
-    
-    painter.drawText(rect, Qt::AlignCenter, text);
-    painter.end();
+    // Arrowheads are sized in pixels by the shader, so zooming needs no rebuild
+    dimensionRenderer.draw(1.0f / zoom, Qt::green);
+    labelAtlas.draw(size() * devicePixelRatioF(), Qt::green);
 }
 
 void GLWidget::addDimension(const QVector2D& start, const QVector2D& end, float offset)
@@ -981,7 +1140,14 @@ void GLWidget::addDimension(const QVector2D& start, const QVector2D& end, float
     dim.offset = offset;
     dim.measurement = (end - start).length();
     dim.text = QString::number(dim.measurement, 'f', 2);
+
+    // The label sits centred on the dimension line
+    QVector2D direction = end - start;
+    QVector2D perp = QVector2D(-direction.y(), direction.x()).normalized();
+    dim.labelAnchor = (start + end) * 0.5f + perp * offset;
+
     dimensions.push_back(dim);
+    dimensionsDirty = true;
 }
 
 void GLWidget::startDimensionDrawing()
@@ -997,29 +1163,14 @@ void GLWidget::startDimensionDrawing()
 void GLWidget::selectObjectAt(const QVector2D& point)
 {
     const float selectionRadius = 10.0f / zoom;  // Adjust as needed
-    int index = -1;
-
-    for (size_t i = 0; i < lines.size(); ++i) {
-        const Line& line = lines[i];
-        // Check distance from point to line segment
-        QVector2D ab = line.end - line.start;
-        QVector2D ap = point - line.start;
-        float ab_length_squared = ab.lengthSquared();
-        float t = QVector2D::dotProduct(ap, ab) / ab_length_squared;
-        t = std::clamp(t, 0.0f, 1.0f);
-        QVector2D projection = line.start + ab * t;
-        float distance = (point - projection).length();
-
-        if (distance <= selectionRadius) {
-            index = static_cast<int>(i);
-            break;
-        }
-    }
+    int index = selection.pickLine(point, selectionRadius);
 
     if (index != -1) {
         objectSelected = true;
-        selectedObjectIndices.clear();
-        selectedObjectIndices.push_back(index);
+        selectionSet.clear();
+        selectionSet.insert(index);
+        selectedObject = document.handleAt(index);
+        invalidateScene();
         // Set moveHoldPoint to the initial click position for accurate delta calculation
         moveHoldPoint = point;
     }
@@ -1031,19 +1182,12 @@ void GLWidget::selectObjectAt(const QVector2D& point)
 void GLWidget::deselectObject()
 {
     objectSelected = false;
-    selectedObjectIndex = -1;
+    selectedObject = EntityHandle();
 }
 
 void GLWidget::moveSelectedObject(const QVector2D& delta)
 {
-    for (int index : selectedObjectIndices) {
-        if (index >= 0 && index < static_cast<int>(lines.size())) {
-            lines[index].start += delta;
-            lines[index].end += delta;
-        }
-    }
-    
-    snapManager->updateSettings(snapThreshold, zoom, lines);
+    document.moveLines(selectionSet.indices(), delta);
     update();
 }
 
@@ -1058,15 +1202,14 @@ void GLWidget::setCurrentMode(DrawMode mode)
     if (dimensionButton) dimensionButton->setDown(mode == MODE_DIMENSION);
     
     // Reset and reinitialize snap system when changing modes
-    if (snapManager) {
-        snapManager->updateSettings(snapThreshold, zoom, lines);
-    }
+    clearSnap();
 
     // Clear selection and reset move states when mode changes
     if (mode != MODE_MOVE && mode != MODE_NONE) {
-        selectedObjectIndices.clear();
+        selectionSet.clear();
+        invalidateScene();
         objectSelected = false;
-        selectedObjectIndex = -1;
+        selectedObject = EntityHandle();
         isDragging = false;
         update();
     }
@@ -1105,58 +1248,46 @@ void GLWidget::triggerUpdateCommandStatus()
     updateCommandStatus();
 }
 
-void GLWidget::performRectangleSelection(const QRect& rect)
+void GLWidget::performRectangleSelection(const QRect& rect, Qt::KeyboardModifiers modifiers)
 {
-    selectedObjectIndices.clear();
+    const bool adding = modifiers & Qt::ShiftModifier;
+    const bool removing = modifiers & Qt::ControlModifier;
+    if (!adding && !removing) {
+        selectionSet.clear();
+    }
+    invalidateScene();
     if (rect.isNull()) {
-        objectSelected = false;
-        selectedObjectIndex = -1;
+        objectSelected = !selectionSet.empty();
+        if (!objectSelected) selectedObject = EntityHandle();
         return;
     }
 
     // Convert QRect to world coordinates
     QVector2D topLeft(screenToWorld(rect.topLeft()));
-    QVector2D topRight(screenToWorld(rect.topRight()));
     QVector2D bottomRight(screenToWorld(rect.bottomRight()));
-    QVector2D bottomLeft(screenToWorld(rect.bottomLeft()));
 
     QRectF worldRect(QPointF(std::min(topLeft.x(), bottomRight.x()), std::min(topLeft.y(), bottomRight.y())),
                     QPointF(std::max(topLeft.x(), bottomRight.x()), std::max(topLeft.y(), bottomRight.y())));
 
-    for (size_t i = 0; i < lines.size(); ++i) {
-        const Line& line = lines[i];
-        bool shouldSelect = false;
-
-        if (isCrossingSelection) {
-            // Crossing selection (right-to-left OR bottom-to-top):
-            // Select if line intersects with rectangle or has endpoint inside
-            bool intersects = false;
-            intersects |= linesIntersect(line.start, line.end, topLeft, topRight);
-            intersects |= linesIntersect(line.start, line.end, topRight, bottomRight);
-            intersects |= linesIntersect(line.start, line.end, bottomRight, bottomLeft);
-            intersects |= linesIntersect(line.start, line.end, bottomLeft, topLeft);
-
-            bool pointInside = worldRect.contains(QPointF(line.start.x(), line.start.y())) ||
-                             worldRect.contains(QPointF(line.end.x(), line.end.y()));
-
-            shouldSelect = intersects || pointInside;
-        } else {
-            // Window selection (left-to-right AND top-to-bottom):
-            // Select only if line is completely inside
-            shouldSelect = worldRect.contains(QPointF(line.start.x(), line.start.y())) &&
-                         worldRect.contains(QPointF(line.end.x(), line.end.y()));
-        }
-
-        if (shouldSelect) {
-            selectedObjectIndices.push_back(static_cast<int>(i));
-        }
+    // Crossing selection (right-to-left OR bottom-to-top) also takes lines
+    // cutting the rectangle; window selection only the ones inside it
+    std::vector<int> hits;
+    selection.selectInRect(worldRect, isCrossingSelection, hits);
+    if (removing) {
+        selectionSet.subtract(hits);
+    } else {
+        selectionSet.unite(hits);
     }
 
-    objectSelected = !selectedObjectIndices.empty();
+    objectSelected = !selectionSet.empty();
     if (objectSelected) {
-        selectedObjectIndex = selectedObjectIndices[0];
+        // Keep the primary line while it is still selected
+        int primary = document.indexOf(selectedObject);
+        if (primary < 0 || !selectionSet.contains(primary)) {
+            selectedObject = document.handleAt(selectionSet.indices().front());
+        }
     } else {
-        selectedObjectIndex = -1;
+        selectedObject = EntityHandle();
     }
     
     // Update status after selection
@@ -1164,29 +1295,46 @@ void GLWidget::performRectangleSelection(const QRect& rect)
     update();
 }
 
-void GLWidget::deleteSelectedObjects()
+void GLWidget::invertSelection()
 {
-    if (selectedObjectIndices.empty()) return;
+    selectionSet.invert(document.size());
+    objectSelected = !selectionSet.empty();
+    selectedObject = objectSelected ? document.handleAt(selectionSet.indices().front()) : EntityHandle();
+    invalidateScene();
+    updateCommandStatus();
+    update();
+}
 
-    // Sort indices in descending order to remove from back to front
-    std::sort(selectedObjectIndices.begin(), selectedObjectIndices.end(), std::greater<int>());
+void GLWidget::selectConnected()
+{
+    if (selectionSet.empty()) return;
 
-    // Remove the selected lines
-    for (int index : selectedObjectIndices) {
-        if (index >= 0 && index < static_cast<int>(lines.size())) {
-            lines.erase(lines.begin() + index);
-        }
+    std::vector<int> connected;
+    topology.connectedLines(selectionSet.indices(), connected);
+    if (!weldEndpoints) {
+        topology.clear();
     }
+    selectionSet.assign(connected);
+    invalidateScene();
+    updateCommandStatus();
+    update();
+}
+
+void GLWidget::deleteSelectedObjects()
+{
+    if (selectionSet.empty()) return;
+
+    // Remove the selected lines in a single pass
+    document.eraseLines(selectionSet.indices());
 
     // Clear selection
-    selectedObjectIndices.clear();
+    selectionSet.clear();
     objectSelected = false;
-    selectedObjectIndex = -1;
+    selectedObject = EntityHandle();
+    invalidateScene();
 
     // Update snap manager and UI
-    if (snapManager) {
-        snapManager->updateSettings(snapThreshold, zoom, lines);
-    }
+    clearSnap();
     
     updateCommandStatus();
     update();
@@ -1196,7 +1344,7 @@ void GLWidget::deleteSelectedObjects()
 
 void GLWidget::zoomAll()
 {
-    if (lines.empty()) {
+    if (document.empty()) {
         // Reset to default view if no lines are present
         pan = QVector2D(0, 0);
         zoom = 1.0f;
@@ -1210,13 +1358,19 @@ void GLWidget::zoomAll()
     float maxX = std::numeric_limits<float>::lowest();
     float maxY = std::numeric_limits<float>::lowest();
 
-    for (const auto& line : lines) {
-        minX = std::min(minX, std::min(line.start.x(), line.end.x()));
-        minY = std::min(minY, std::min(line.start.y(), line.end.y()));
-        maxX = std::max(maxX, std::max(line.start.x(), line.end.x()));
-        maxY = std::max(maxY, std::max(line.start.y(), line.end.y()));
+    const LineStore& lines = document.lines();
+    for (size_t i = 0; i < lines.size(); ++i) {
+        minX = std::min(minX, lines.minX(i));
+        minY = std::min(minY, lines.minY(i));
+        maxX = std::max(maxX, lines.maxX(i));
+        maxY = std::max(maxY, lines.maxY(i));
     }
 
+    zoomToBounds(minX, minY, maxX, maxY);
+}
+
+void GLWidget::zoomToBounds(float minX, float minY, float maxX, float maxY)
+{
     // Calculate the center of the bounding box
     QVector2D center((minX + maxX) / 2.0f, (minY + maxY) / 2.0f);
 
@@ -1239,15 +1393,15 @@ void GLWidget::zoomAll()
     // Center the view
     pan = QVector2D(-center.x() * zoom, -center.y() * zoom);
 
-    // Update SnapManager with new zoom and pan
-    snapManager->updateSettings(snapThreshold, zoom, lines);
+    // Snaps found at the old zoom no longer apply
+    clearSnap();
 
     update();
 }
 
 bool GLWidget::saveDxf(const QString& filename)
 {
-    bool success = DxfHandler::saveDxf(filename, lines);
+    bool success = DxfHandler::saveDxf(filename, document.lines());
     if (success) {
         currentCommand = "File saved: " + filename;
     } else {
@@ -1260,22 +1414,150 @@ bool GLWidget::saveDxf(const QString& filename)
 
 bool GLWidget::loadDxf(const QString& filename)
 {
-    std::vector<Line> loadedLines;
-    bool success = DxfHandler::loadDxf(filename, loadedLines);
-    
-    if (success) {
-        lines = loadedLines;
-        snapManager->updateSettings(snapThreshold, zoom, lines);
-        currentCommand = "File loaded: " + filename;
-        zoomAll();  // Adjust view to show all loaded lines
+    // Unreadable files fail right away; parse errors are reported when the
+    // background load finishes
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) {
+        currentCommand = "Error loading file!";
+        emit commandChanged(currentCommand);
+        updateCommandStatus();
+        return false;
+    }
+    file.close();
+
+    stopLoading();
+
+    // The current drawing stays until the first batch of the new one
+    // arrives, so a cancelled or failed load leaves it untouched
+    loadReplaced = false;
+    loadHasExtents = false;
+    loadPercent = 0;
+    loadFramed = false;
+
+    const quint64 generation = ++loadGeneration;
+    dxfLoadThread = new QThread(this);
+    dxfLoader = new DxfLoader(filename);
+    dxfLoader->moveToThread(dxfLoadThread);
+
+    connect(dxfLoadThread, &QThread::started, dxfLoader, &DxfLoader::run);
+    connect(dxfLoader, &DxfLoader::extentsFound, this, [this, generation](const QVector2D& min, const QVector2D& max) {
+        if (generation == loadGeneration) onDxfExtents(min, max);
+    });
+    connect(dxfLoader, &DxfLoader::batchLoaded, this, [this, generation](const LineStore& batch) {
+        if (generation == loadGeneration) onDxfBatch(batch);
+    });
+    connect(dxfLoader, &DxfLoader::progress, this, [this, generation](int percent) {
+        if (generation == loadGeneration) onDxfProgress(percent);
+    });
+    connect(dxfLoader, &DxfLoader::finished, this, [this, generation](bool success, bool cancelled, const DxfLoadStats& stats) {
+        if (generation == loadGeneration) onDxfFinished(success, cancelled, stats);
+    });
+    dxfLoadThread->start();
+
+    currentCommand = "Loading: " + filename;
+    emit commandChanged(currentCommand);
+    updateCommandStatus();
+    update();
+    return true;
+}
+
+void GLWidget::stopLoading()
+{
+    if (!dxfLoadThread) return;
+
+    // Signals it already queued are dropped by the generation check
+    ++loadGeneration;
+    dxfLoader->cancel();
+    dxfLoadThread->quit();
+    dxfLoadThread->wait();
+
+    delete dxfLoader;
+    delete dxfLoadThread;
+    dxfLoader = nullptr;
+    dxfLoadThread = nullptr;
+}
+
+void GLWidget::onDxfExtents(const QVector2D& min, const QVector2D& max)
+{
+    // Frame the drawing before the first entity arrives, but not while the
+    // previous drawing is still the one on screen
+    loadMin = min;
+    loadMax = max;
+    loadHasExtents = true;
+    if (loadReplaced) {
+        zoomToBounds(min.x(), min.y(), max.x(), max.y());
+        loadFramed = true;
+    }
+}
+
+void GLWidget::replaceDrawing()
+{
+    document.clear();
+    selectionSet.clear();
+    objectSelected = false;
+    selectedObject = EntityHandle();
+    invalidateScene();
+    loadReplaced = true;
+
+    if (loadHasExtents) {
+        zoomToBounds(loadMin.x(), loadMin.y(), loadMax.x(), loadMax.y());
+        loadFramed = true;
+    }
+}
+
+void GLWidget::onDxfBatch(const LineStore& batch)
+{
+    // Cleared before welding so the batch never welds to the old lines
+    if (!loadReplaced) {
+        replaceDrawing();
+    }
+
+    if (weldEndpoints) {
+        // Welds to the lines of earlier batches too
+        LineStore welded = batch;
+        topology.weldLines(welded);
+        document.appendLines(welded);
+    } else {
+        document.appendLines(batch);
+    }
+    update();
+}
+
+void GLWidget::onDxfProgress(int percent)
+{
+    loadPercent = percent;
+    updateCommandStatus();
+}
+
+void GLWidget::onDxfFinished(bool success, bool cancelled, const DxfLoadStats& stats)
+{
+    const QString filename = dxfLoader->fileName();
+    stopLoading();
+
+    if (cancelled) {
+        if (loadReplaced) {
+            currentCommand = QString("Loading canceled: %1 lines kept").arg(static_cast<qint64>(document.size()));
+        } else {
+            currentCommand = "Loading canceled";
+        }
+    } else if (success) {
+        if (!loadReplaced) {
+            replaceDrawing();  // A file without entities still replaces the drawing
+        }
+        if (!loadFramed) {
+            zoomAll();  // No usable header extents; fit what was loaded
+        }
+        currentCommand = QString("File loaded: %1 (%2 lines, %3 MB/s)")
+                             .arg(filename)
+                             .arg(static_cast<qint64>(stats.entities))
+                             .arg(stats.megabytesPerSecond(), 0, 'f', 1);
     } else {
         currentCommand = "Error loading file!";
     }
-    
+
     emit commandChanged(currentCommand);
     updateCommandStatus();
     update();
-    return success;
 }
 
 // ...existing code...
@@ -1283,9 +1565,12 @@ bool GLWidget::loadDxf(const QString& filename)
 void GLWidget::resetAll()
 {
     // Clear all data
-    lines.clear();
+    stopLoading();
+    document.clear();
     dimensions.clear();
-    selectedObjectIndices.clear();
+    dimensionsDirty = true;
+    selectionSet.clear();
+    invalidateScene();
     
     // Reset view
     pan = QVector2D(0, 0);
@@ -1295,14 +1580,12 @@ void GLWidget::resetAll()
     isDrawing = false;
     hasFirstPoint = false;
     objectSelected = false;
-    selectedObjectIndex = -1;
+    selectedObject = EntityHandle();
     isDragging = false;
     currentMode = MODE_NONE;
     
     // Reset snap system
-    if (snapManager) {
-        snapManager->updateSettings(snapThreshold, zoom, lines);
-    }
+    clearSnap();
     
     // Update UI
     currentCommand = "Ready";
@@ -1314,7 +1597,7 @@ void GLWidget::resetAll()
 // ...existing code...
 
 void GLWidget::renderGhostObjects() {
-    if (!ghostTracker.isTracking() || selectedObjectIndices.empty()) {
+    if (!ghostTracker.isTracking() || selectionSet.empty()) {
         return;
     }
 
@@ -1327,20 +1610,20 @@ void GLWidget::renderGhostObjects() {
     QColor ghost = GhostTracker::ghostColor();
     glColor4f(ghost.redF(), ghost.greenF(), ghost.blueF(), ghost.alphaF());
 
+    const LineStore& lines = document.lines();
     glBegin(GL_LINES);
-    for (int index : selectedObjectIndices) {
-        if (index >= 0 && static_cast<size_t>(index) < lines.size()) {
-            const Line& line = lines[index];
+    for (int index : selectionSet.indices()) {
+        if (static_cast<size_t>(index) < lines.size()) {
             QVector2D ghostStart, ghostEnd;
             
             if (isAwaitingMoveEndPoint) {
                 // Show ghost at offset from original position
-                ghostStart = line.start + moveOffset;
-                ghostEnd = line.end + moveOffset;
+                ghostStart = lines.start(index) + moveOffset;
+                ghostEnd = lines.end(index) + moveOffset;
             } else {
                 // Show ghost at current mouse position
-                ghostStart = line.start;
-                ghostEnd = line.end;
+                ghostStart = lines.start(index);
+                ghostEnd = lines.end(index);
                 QVector2D delta(offset.x(), offset.y());
                 ghostStart += delta;
                 ghostEnd += delta;
@@ -1357,36 +1640,11 @@ void GLWidget::renderGhostObjects() {
 
 void GLWidget::setSelectedObjectsColor(const QColor& color)
 {
-    for (int index : selectedObjectIndices) {
-        if (index >= 0 && index < static_cast<int>(lines.size())) {
-            lines[index].color = color;
-        }
-    }
+    document.setLinesColor(selectionSet.indices(), color);
     update();
 }
 
 // Add the line intersection helper function
-bool GLWidget::linesIntersect(const QVector2D& p1, const QVector2D& p2,
-                            const QVector2D& q1, const QVector2D& q2) const
-{
-    auto orientation = [](const QVector2D& a, const QVector2D& b, const QVector2D& c) -> int {
-        float val = (b.y() - a.y()) * (c.x() - b.x()) - 
-                    (b.x() - a.x()) * (c.y() - b.y());
-        if (val == 0.0f) return 0; // colinear
-        return (val > 0.0f) ? 1 : 2; // clock or counterclock wise
-    };
-
-    int o1 = orientation(p1, p2, q1);
-    int o2 = orientation(p1, p2, q2);
-    int o3 = orientation(q1, q2, p1);
-    int o4 = orientation(q1, q2, p2);
-
-    if (o1 != o2 && o3 != o4)
-        return true;
-
-    return false;
-}
-
 // ...rest of existing code...
 
 void GLWidget::startDeleteMode()
@@ -1429,15 +1687,51 @@ void GLWidget::addTrackPoint(const QVector2D& point, const QVector2D& dir, Track
     TrackPoint tp;
     tp.point = point;
     tp.direction = dir;
-    tp.timestamp = QDateTime::currentMSecsSinceEpoch();
+    tp.timestamp = overlayTime();
     tp.type = type;
     trackPoints.push_back(tp);
+    scheduleExpiry();
 }
 
-void GLWidget::updateTrackPoints()
+void GLWidget::scheduleExpiry()
 {
-    qint64 currentTime = QDateTime::currentMSecsSinceEpoch();
-    
+    qint64 deadline = std::numeric_limits<qint64>::max();
+    if (lastSnap.isActive) {
+        deadline = std::min(deadline, lastSnap.timestamp + static_cast<qint64>(snapHistoryTimeout * 1000));
+    }
+    for (const auto& tp : trackPoints) {
+        deadline = std::min(deadline, tp.timestamp + static_cast<qint64>(trackTimeout * 1000));
+    }
+    for (const auto& ts : trackingPoints) {
+        if (ts.isActive) {
+            deadline = std::min(deadline, ts.timestamp + static_cast<qint64>(trackingTimeout * 1000));
+        }
+    }
+
+    if (deadline == std::numeric_limits<qint64>::max()) {
+        expiryTimer->stop();
+        return;
+    }
+    // An earlier deadline already armed re-arms for the rest when it fires
+    if (expiryTimer->isActive() && armedDeadline <= deadline) {
+        return;
+    }
+    // Expiry is tested with '>', so fire just past the deadline
+    armedDeadline = deadline;
+    expiryTimer->start(static_cast<int>(std::max<qint64>(0, deadline - overlayTime() + 1)));
+}
+
+void GLWidget::expireOverlays()
+{
+    const qint64 currentTime = overlayTime();
+    bool expired = false;
+
+    if (lastSnap.isActive && (currentTime - lastSnap.timestamp) / 1000.0f > snapHistoryTimeout) {
+        clearSnapHistory();
+        expired = true;
+    }
+
+    const size_t trackCount = trackPoints.size();
     trackPoints.erase(
         std::remove_if(trackPoints.begin(), trackPoints.end(),
             [&](const TrackPoint& tp) {
@@ -1445,10 +1739,21 @@ void GLWidget::updateTrackPoints()
             }),
         trackPoints.end()
     );
-    
-    if (!trackPoints.empty()) {
+
+    const size_t trackingCount = trackingPoints.size();
+    trackingPoints.erase(
+        std::remove_if(trackingPoints.begin(), trackingPoints.end(),
+            [&](const TrackingState& ts) {
+                return !ts.isActive || ((currentTime - ts.timestamp) / 1000.0f) > trackingTimeout;
+            }),
+        trackingPoints.end());
+
+    // These are overlays on top of the cached scene, so this repaint does
+    // not redraw the document
+    if (expired || trackPoints.size() != trackCount || trackingPoints.size() != trackingCount) {
         update();
     }
+    scheduleExpiry();
 }
 
 void GLWidget::drawTrackPoints() const
@@ -1492,7 +1797,7 @@ void GLWidget::setTrackPoint(const QVector2D& point, const QVector2D& dir)
 {
     currentTrackPoint.point = point;
     currentTrackPoint.direction = dir;
-    currentTrackPoint.timestamp = QDateTime::currentMSecsSinceEpoch();
+    currentTrackPoint.timestamp = overlayTime();
     currentTrackPoint.isBase = true;
     hasTrackPoint = true;
 }
@@ -1650,7 +1955,7 @@ void GLWidget::clearTrackLines()
 
 void GLWidget::updateTracking(const QVector2D& snapPoint)
 {
-    qint64 currentTime = QDateTime::currentMSecsSinceEpoch();
+    qint64 currentTime = overlayTime();
     
     // Remove expired tracking points
     trackingPoints.erase(
@@ -1684,6 +1989,7 @@ void GLWidget::updateTracking(const QVector2D& snapPoint)
     }
     
     trackingPoints.push_back(newTrack);
+    scheduleExpiry();
 }
 
 void GLWidget::drawTrackingLines()
@@ -1835,7 +2141,7 @@ void GLWidget::drawShiftSnapLines()
 
 void GLWidget::updateTrackingPoint(const QVector2D& point)
 {
-    qint64 currentTime = QDateTime::currentMSecsSinceEpoch();
+    qint64 currentTime = overlayTime();
     
     // Remove expired points
     trackPoints.erase(
@@ -1852,6 +2158,7 @@ void GLWidget::updateTrackingPoint(const QVector2D& point)
             tp.timestamp = currentTime;  // Refresh timestamp
             lastTrackPoint = tp;
             hasActiveTracking = true;
+            scheduleExpiry();
             update();
             return;
         }
@@ -1873,6 +2180,7 @@ void GLWidget::updateTrackingPoint(const QVector2D& point)
     trackPoints.push_back(newPoint);
     lastTrackPoint = newPoint;
     hasActiveTracking = true;
+    scheduleExpiry();
     update();
 }
 
@@ -0,0 +1,589 @@
+#include "GeometryKernels.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define GEOMETRY_KERNELS_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#endif
+
+// AVX2 code is compiled per function, so the rest of the program keeps
+// running on CPUs without it. MSVC accepts the intrinsics anywhere.
+#if defined(__GNUC__) || defined(__clang__)
+#define AVX2_FUNCTION __attribute__((target("avx2")))
+#else
+#define AVX2_FUNCTION
+#endif
+
+namespace GeometryKernels {
+
+namespace {
+
+// One segment at a time. The vector versions below evaluate exactly these
+// expressions, lane by lane, and fall back to them for the last few ids.
+namespace scalar {
+
+inline float clampUnit(float t)
+{
+    // Written so a NaN passes through, as the vector min/max below do
+    t = 0.0f > t ? 0.0f : t;
+    return 1.0f < t ? 1.0f : t;
+}
+
+inline float distanceSquared(const Segments& s, int i, float px, float py)
+{
+    const float abx = s.x1[i] - s.x0[i];
+    const float aby = s.y1[i] - s.y0[i];
+    const float apx = px - s.x0[i];
+    const float apy = py - s.y0[i];
+    const float lengthSquared = abx * abx + aby * aby;
+    const float t = clampUnit((apx * abx + apy * aby) / lengthSquared);
+    const float dx = px - (s.x0[i] + abx * t);
+    const float dy = py - (s.y0[i] + aby * t);
+    return dx * dx + dy * dy;
+}
+
+inline void project(const Segments& s, int i, float px, float py, float minLengthSquared, float& t, float& x, float& y)
+{
+    const float abx = s.x1[i] - s.x0[i];
+    const float aby = s.y1[i] - s.y0[i];
+    const float apx = px - s.x0[i];
+    const float apy = py - s.y0[i];
+    const float lengthSquared = abx * abx + aby * aby;
+    t = (apx * abx + apy * aby) / lengthSquared;
+    if (lengthSquared <= minLengthSquared) {
+        t = std::numeric_limits<float>::quiet_NaN();
+    }
+    const float clamped = clampUnit(t);
+    x = s.x0[i] + abx * clamped;
+    y = s.y0[i] + aby * clamped;
+}
+
+inline void pointDistances(const Segments& s, int i, float px, float py, float& start, float& end, float& mid)
+{
+    const float sx = px - s.x0[i];
+    const float sy = py - s.y0[i];
+    const float ex = px - s.x1[i];
+    const float ey = py - s.y1[i];
+    const float mx = px - (s.x0[i] + s.x1[i]) * 0.5f;
+    const float my = py - (s.y0[i] + s.y1[i]) * 0.5f;
+    start = sx * sx + sy * sy;
+    end = ex * ex + ey * ey;
+    mid = mx * mx + my * my;
+}
+
+inline bool intersectPair(const Segments& s, int a, int b)
+{
+    const float x1 = s.x0[a], y1 = s.y0[a];
+    const float x2 = s.x1[a], y2 = s.y1[a];
+    const float x3 = s.x0[b], y3 = s.y0[b];
+    const float x4 = s.x1[b], y4 = s.y1[b];
+
+    const float denom = (x1 - x2) * (y3 - y4) - (y1 - y2) * (x3 - x4);
+    if (std::abs(denom) < 1e-6f) return false;
+
+    const float t = ((x1 - x3) * (y3 - y4) - (y1 - y3) * (x3 - x4)) / denom;
+    const float u = -((x1 - x2) * (y1 - y3) - (y1 - y2) * (x1 - x3)) / denom;
+    return t >= 0.0f && t <= 1.0f && u >= 0.0f && u <= 1.0f;
+}
+
+inline bool overlapsRect(const Segments& s, int i, float minX, float minY, float maxX, float maxY)
+{
+    const float x0 = s.x0[i], y0 = s.y0[i];
+    const float x1 = s.x1[i], y1 = s.y1[i];
+    if (std::min(x0, x1) > maxX || std::max(x0, x1) < minX ||
+        std::min(y0, y1) > maxY || std::max(y0, y1) < minY) {
+        return false;
+    }
+
+    // Separated when all four corners lie strictly on one side of the line
+    const float dx = x1 - x0;
+    const float dy = y1 - y0;
+    const float c0 = dx * (minY - y0) - dy * (minX - x0);
+    const float c1 = dx * (minY - y0) - dy * (maxX - x0);
+    const float c2 = dx * (maxY - y0) - dy * (maxX - x0);
+    const float c3 = dx * (maxY - y0) - dy * (minX - x0);
+    const bool above = c0 > 0.0f && c1 > 0.0f && c2 > 0.0f && c3 > 0.0f;
+    const bool below = c0 < 0.0f && c1 < 0.0f && c2 < 0.0f && c3 < 0.0f;
+    return !above && !below;
+}
+
+} // namespace scalar
+
+#ifdef GEOMETRY_KERNELS_X86
+
+// SSE2 is part of x86-64, so these need no runtime check
+namespace sse2 {
+
+inline __m128 gather(const float* column, const int* ids)
+{
+    return _mm_setr_ps(column[ids[0]], column[ids[1]], column[ids[2]], column[ids[3]]);
+}
+
+inline __m128 clampUnit(__m128 t)
+{
+    // max/min return their second operand for NaN, which keeps it
+    t = _mm_max_ps(_mm_setzero_ps(), t);
+    return _mm_min_ps(_mm_set1_ps(1.0f), t);
+}
+
+inline void storeMask(__m128 mask, unsigned char* out)
+{
+    const int bits = _mm_movemask_ps(mask);
+    for (int k = 0; k < 4; ++k) {
+        out[k] = static_cast<unsigned char>((bits >> k) & 1);
+    }
+}
+
+void distanceSquared(const Segments& s, const int* ids, size_t count, float px, float py, float* out)
+{
+    const __m128 vpx = _mm_set1_ps(px);
+    const __m128 vpy = _mm_set1_ps(py);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128 x0 = gather(s.x0, ids + i);
+        const __m128 y0 = gather(s.y0, ids + i);
+        const __m128 abx = _mm_sub_ps(gather(s.x1, ids + i), x0);
+        const __m128 aby = _mm_sub_ps(gather(s.y1, ids + i), y0);
+        const __m128 apx = _mm_sub_ps(vpx, x0);
+        const __m128 apy = _mm_sub_ps(vpy, y0);
+        const __m128 lengthSquared = _mm_add_ps(_mm_mul_ps(abx, abx), _mm_mul_ps(aby, aby));
+        const __m128 t = clampUnit(_mm_div_ps(_mm_add_ps(_mm_mul_ps(apx, abx), _mm_mul_ps(apy, aby)), lengthSquared));
+        const __m128 dx = _mm_sub_ps(vpx, _mm_add_ps(x0, _mm_mul_ps(abx, t)));
+        const __m128 dy = _mm_sub_ps(vpy, _mm_add_ps(y0, _mm_mul_ps(aby, t)));
+        _mm_storeu_ps(out + i, _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)));
+    }
+    for (; i < count; ++i) {
+        out[i] = scalar::distanceSquared(s, ids[i], px, py);
+    }
+}
+
+void project(const Segments& s, const int* ids, size_t count, float px, float py,
+             float minLengthSquared, float* t, float* x, float* y)
+{
+    const __m128 vpx = _mm_set1_ps(px);
+    const __m128 vpy = _mm_set1_ps(py);
+    const __m128 minimum = _mm_set1_ps(minLengthSquared);
+    const __m128 nan = _mm_set1_ps(std::numeric_limits<float>::quiet_NaN());
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128 x0 = gather(s.x0, ids + i);
+        const __m128 y0 = gather(s.y0, ids + i);
+        const __m128 abx = _mm_sub_ps(gather(s.x1, ids + i), x0);
+        const __m128 aby = _mm_sub_ps(gather(s.y1, ids + i), y0);
+        const __m128 apx = _mm_sub_ps(vpx, x0);
+        const __m128 apy = _mm_sub_ps(vpy, y0);
+        const __m128 lengthSquared = _mm_add_ps(_mm_mul_ps(abx, abx), _mm_mul_ps(aby, aby));
+        __m128 vt = _mm_div_ps(_mm_add_ps(_mm_mul_ps(apx, abx), _mm_mul_ps(apy, aby)), lengthSquared);
+        const __m128 degenerate = _mm_cmple_ps(lengthSquared, minimum);
+        vt = _mm_or_ps(_mm_andnot_ps(degenerate, vt), _mm_and_ps(degenerate, nan));
+        const __m128 clamped = clampUnit(vt);
+        _mm_storeu_ps(t + i, vt);
+        _mm_storeu_ps(x + i, _mm_add_ps(x0, _mm_mul_ps(abx, clamped)));
+        _mm_storeu_ps(y + i, _mm_add_ps(y0, _mm_mul_ps(aby, clamped)));
+    }
+    for (; i < count; ++i) {
+        scalar::project(s, ids[i], px, py, minLengthSquared, t[i], x[i], y[i]);
+    }
+}
+
+void pointDistances(const Segments& s, const int* ids, size_t count, float px, float py,
+                    float* start, float* end, float* mid)
+{
+    const __m128 vpx = _mm_set1_ps(px);
+    const __m128 vpy = _mm_set1_ps(py);
+    const __m128 half = _mm_set1_ps(0.5f);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128 x0 = gather(s.x0, ids + i);
+        const __m128 y0 = gather(s.y0, ids + i);
+        const __m128 x1 = gather(s.x1, ids + i);
+        const __m128 y1 = gather(s.y1, ids + i);
+        const __m128 sx = _mm_sub_ps(vpx, x0);
+        const __m128 sy = _mm_sub_ps(vpy, y0);
+        const __m128 ex = _mm_sub_ps(vpx, x1);
+        const __m128 ey = _mm_sub_ps(vpy, y1);
+        const __m128 mx = _mm_sub_ps(vpx, _mm_mul_ps(_mm_add_ps(x0, x1), half));
+        const __m128 my = _mm_sub_ps(vpy, _mm_mul_ps(_mm_add_ps(y0, y1), half));
+        _mm_storeu_ps(start + i, _mm_add_ps(_mm_mul_ps(sx, sx), _mm_mul_ps(sy, sy)));
+        _mm_storeu_ps(end + i, _mm_add_ps(_mm_mul_ps(ex, ex), _mm_mul_ps(ey, ey)));
+        _mm_storeu_ps(mid + i, _mm_add_ps(_mm_mul_ps(mx, mx), _mm_mul_ps(my, my)));
+    }
+    for (; i < count; ++i) {
+        scalar::pointDistances(s, ids[i], px, py, start[i], end[i], mid[i]);
+    }
+}
+
+void intersectPairs(const Segments& s, const int* a, const int* b, size_t count, unsigned char* hit)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 epsilon = _mm_set1_ps(1e-6f);
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128 x1 = gather(s.x0, a + i), y1 = gather(s.y0, a + i);
+        const __m128 x2 = gather(s.x1, a + i), y2 = gather(s.y1, a + i);
+        const __m128 x3 = gather(s.x0, b + i), y3 = gather(s.y0, b + i);
+        const __m128 x4 = gather(s.x1, b + i), y4 = gather(s.y1, b + i);
+
+        const __m128 dx12 = _mm_sub_ps(x1, x2), dy12 = _mm_sub_ps(y1, y2);
+        const __m128 dx34 = _mm_sub_ps(x3, x4), dy34 = _mm_sub_ps(y3, y4);
+        const __m128 dx13 = _mm_sub_ps(x1, x3), dy13 = _mm_sub_ps(y1, y3);
+        const __m128 denom = _mm_sub_ps(_mm_mul_ps(dx12, dy34), _mm_mul_ps(dy12, dx34));
+        const __m128 t = _mm_div_ps(_mm_sub_ps(_mm_mul_ps(dx13, dy34), _mm_mul_ps(dy13, dx34)), denom);
+        const __m128 u = _mm_div_ps(_mm_xor_ps(sign, _mm_sub_ps(_mm_mul_ps(dx12, dy13), _mm_mul_ps(dy12, dx13))), denom);
+
+        __m128 mask = _mm_cmpge_ps(_mm_andnot_ps(sign, denom), epsilon);
+        mask = _mm_and_ps(mask, _mm_and_ps(_mm_cmpge_ps(t, zero), _mm_cmple_ps(t, one)));
+        mask = _mm_and_ps(mask, _mm_and_ps(_mm_cmpge_ps(u, zero), _mm_cmple_ps(u, one)));
+        storeMask(mask, hit + i);
+    }
+    for (; i < count; ++i) {
+        hit[i] = scalar::intersectPair(s, a[i], b[i]);
+    }
+}
+
+void overlapsRect(const Segments& s, const int* ids, size_t count,
+                  float minX, float minY, float maxX, float maxY, unsigned char* hit)
+{
+    const __m128 left = _mm_set1_ps(minX), right = _mm_set1_ps(maxX);
+    const __m128 bottom = _mm_set1_ps(minY), top = _mm_set1_ps(maxY);
+    const __m128 zero = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128 x0 = gather(s.x0, ids + i), y0 = gather(s.y0, ids + i);
+        const __m128 x1 = gather(s.x1, ids + i), y1 = gather(s.y1, ids + i);
+
+        __m128 mask = _mm_and_ps(_mm_cmple_ps(_mm_min_ps(x0, x1), right), _mm_cmpge_ps(_mm_max_ps(x0, x1), left));
+        mask = _mm_and_ps(mask, _mm_and_ps(_mm_cmple_ps(_mm_min_ps(y0, y1), top), _mm_cmpge_ps(_mm_max_ps(y0, y1), bottom)));
+
+        const __m128 dx = _mm_sub_ps(x1, x0);
+        const __m128 dy = _mm_sub_ps(y1, y0);
+        const __m128 toLeft = _mm_mul_ps(dy, _mm_sub_ps(left, x0));
+        const __m128 toRight = _mm_mul_ps(dy, _mm_sub_ps(right, x0));
+        const __m128 toBottom = _mm_mul_ps(dx, _mm_sub_ps(bottom, y0));
+        const __m128 toTop = _mm_mul_ps(dx, _mm_sub_ps(top, y0));
+        const __m128 c0 = _mm_sub_ps(toBottom, toLeft);
+        const __m128 c1 = _mm_sub_ps(toBottom, toRight);
+        const __m128 c2 = _mm_sub_ps(toTop, toRight);
+        const __m128 c3 = _mm_sub_ps(toTop, toLeft);
+        const __m128 above = _mm_and_ps(_mm_and_ps(_mm_cmpgt_ps(c0, zero), _mm_cmpgt_ps(c1, zero)),
+                                        _mm_and_ps(_mm_cmpgt_ps(c2, zero), _mm_cmpgt_ps(c3, zero)));
+        const __m128 below = _mm_and_ps(_mm_and_ps(_mm_cmplt_ps(c0, zero), _mm_cmplt_ps(c1, zero)),
+                                        _mm_and_ps(_mm_cmplt_ps(c2, zero), _mm_cmplt_ps(c3, zero)));
+        storeMask(_mm_andnot_ps(_mm_or_ps(above, below), mask), hit + i);
+    }
+    for (; i < count; ++i) {
+        hit[i] = scalar::overlapsRect(s, ids[i], minX, minY, maxX, maxY);
+    }
+}
+
+} // namespace sse2
+
+namespace avx2 {
+
+AVX2_FUNCTION inline __m256 gather(const float* column, const int* ids)
+{
+    return _mm256_i32gather_ps(column, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ids)), 4);
+}
+
+AVX2_FUNCTION inline __m256 clampUnit(__m256 t)
+{
+    t = _mm256_max_ps(_mm256_setzero_ps(), t);
+    return _mm256_min_ps(_mm256_set1_ps(1.0f), t);
+}
+
+AVX2_FUNCTION inline void storeMask(__m256 mask, unsigned char* out)
+{
+    const int bits = _mm256_movemask_ps(mask);
+    for (int k = 0; k < 8; ++k) {
+        out[k] = static_cast<unsigned char>((bits >> k) & 1);
+    }
+}
+
+AVX2_FUNCTION void distanceSquared(const Segments& s, const int* ids, size_t count, float px, float py, float* out)
+{
+    const __m256 vpx = _mm256_set1_ps(px);
+    const __m256 vpy = _mm256_set1_ps(py);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 x0 = gather(s.x0, ids + i);
+        const __m256 y0 = gather(s.y0, ids + i);
+        const __m256 abx = _mm256_sub_ps(gather(s.x1, ids + i), x0);
+        const __m256 aby = _mm256_sub_ps(gather(s.y1, ids + i), y0);
+        const __m256 apx = _mm256_sub_ps(vpx, x0);
+        const __m256 apy = _mm256_sub_ps(vpy, y0);
+        const __m256 lengthSquared = _mm256_add_ps(_mm256_mul_ps(abx, abx), _mm256_mul_ps(aby, aby));
+        const __m256 t = clampUnit(_mm256_div_ps(_mm256_add_ps(_mm256_mul_ps(apx, abx), _mm256_mul_ps(apy, aby)), lengthSquared));
+        const __m256 dx = _mm256_sub_ps(vpx, _mm256_add_ps(x0, _mm256_mul_ps(abx, t)));
+        const __m256 dy = _mm256_sub_ps(vpy, _mm256_add_ps(y0, _mm256_mul_ps(aby, t)));
+        _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)));
+    }
+    for (; i < count; ++i) {
+        out[i] = scalar::distanceSquared(s, ids[i], px, py);
+    }
+}
+
+AVX2_FUNCTION void project(const Segments& s, const int* ids, size_t count, float px, float py,
+                           float minLengthSquared, float* t, float* x, float* y)
+{
+    const __m256 vpx = _mm256_set1_ps(px);
+    const __m256 vpy = _mm256_set1_ps(py);
+    const __m256 minimum = _mm256_set1_ps(minLengthSquared);
+    const __m256 nan = _mm256_set1_ps(std::numeric_limits<float>::quiet_NaN());
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 x0 = gather(s.x0, ids + i);
+        const __m256 y0 = gather(s.y0, ids + i);
+        const __m256 abx = _mm256_sub_ps(gather(s.x1, ids + i), x0);
+        const __m256 aby = _mm256_sub_ps(gather(s.y1, ids + i), y0);
+        const __m256 apx = _mm256_sub_ps(vpx, x0);
+        const __m256 apy = _mm256_sub_ps(vpy, y0);
+        const __m256 lengthSquared = _mm256_add_ps(_mm256_mul_ps(abx, abx), _mm256_mul_ps(aby, aby));
+        __m256 vt = _mm256_div_ps(_mm256_add_ps(_mm256_mul_ps(apx, abx), _mm256_mul_ps(apy, aby)), lengthSquared);
+        vt = _mm256_blendv_ps(vt, nan, _mm256_cmp_ps(lengthSquared, minimum, _CMP_LE_OQ));
+        const __m256 clamped = clampUnit(vt);
+        _mm256_storeu_ps(t + i, vt);
+        _mm256_storeu_ps(x + i, _mm256_add_ps(x0, _mm256_mul_ps(abx, clamped)));
+        _mm256_storeu_ps(y + i, _mm256_add_ps(y0, _mm256_mul_ps(aby, clamped)));
+    }
+    for (; i < count; ++i) {
+        scalar::project(s, ids[i], px, py, minLengthSquared, t[i], x[i], y[i]);
+    }
+}
+
+AVX2_FUNCTION void pointDistances(const Segments& s, const int* ids, size_t count, float px, float py,
+                                  float* start, float* end, float* mid)
+{
+    const __m256 vpx = _mm256_set1_ps(px);
+    const __m256 vpy = _mm256_set1_ps(py);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 x0 = gather(s.x0, ids + i);
+        const __m256 y0 = gather(s.y0, ids + i);
+        const __m256 x1 = gather(s.x1, ids + i);
+        const __m256 y1 = gather(s.y1, ids + i);
+        const __m256 sx = _mm256_sub_ps(vpx, x0);
+        const __m256 sy = _mm256_sub_ps(vpy, y0);
+        const __m256 ex = _mm256_sub_ps(vpx, x1);
+        const __m256 ey = _mm256_sub_ps(vpy, y1);
+        const __m256 mx = _mm256_sub_ps(vpx, _mm256_mul_ps(_mm256_add_ps(x0, x1), half));
+        const __m256 my = _mm256_sub_ps(vpy, _mm256_mul_ps(_mm256_add_ps(y0, y1), half));
+        _mm256_storeu_ps(start + i, _mm256_add_ps(_mm256_mul_ps(sx, sx), _mm256_mul_ps(sy, sy)));
+        _mm256_storeu_ps(end + i, _mm256_add_ps(_mm256_mul_ps(ex, ex), _mm256_mul_ps(ey, ey)));
+        _mm256_storeu_ps(mid + i, _mm256_add_ps(_mm256_mul_ps(mx, mx), _mm256_mul_ps(my, my)));
+    }
+    for (; i < count; ++i) {
+        scalar::pointDistances(s, ids[i], px, py, start[i], end[i], mid[i]);
+    }
+}
+
+AVX2_FUNCTION void intersectPairs(const Segments& s, const int* a, const int* b, size_t count, unsigned char* hit)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 epsilon = _mm256_set1_ps(1e-6f);
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 x1 = gather(s.x0, a + i), y1 = gather(s.y0, a + i);
+        const __m256 x2 = gather(s.x1, a + i), y2 = gather(s.y1, a + i);
+        const __m256 x3 = gather(s.x0, b + i), y3 = gather(s.y0, b + i);
+        const __m256 x4 = gather(s.x1, b + i), y4 = gather(s.y1, b + i);
+
+        const __m256 dx12 = _mm256_sub_ps(x1, x2), dy12 = _mm256_sub_ps(y1, y2);
+        const __m256 dx34 = _mm256_sub_ps(x3, x4), dy34 = _mm256_sub_ps(y3, y4);
+        const __m256 dx13 = _mm256_sub_ps(x1, x3), dy13 = _mm256_sub_ps(y1, y3);
+        const __m256 denom = _mm256_sub_ps(_mm256_mul_ps(dx12, dy34), _mm256_mul_ps(dy12, dx34));
+        const __m256 t = _mm256_div_ps(_mm256_sub_ps(_mm256_mul_ps(dx13, dy34), _mm256_mul_ps(dy13, dx34)), denom);
+        const __m256 u = _mm256_div_ps(_mm256_xor_ps(sign, _mm256_sub_ps(_mm256_mul_ps(dx12, dy13), _mm256_mul_ps(dy12, dx13))), denom);
+
+        __m256 mask = _mm256_cmp_ps(_mm256_andnot_ps(sign, denom), epsilon, _CMP_GE_OQ);
+        mask = _mm256_and_ps(mask, _mm256_and_ps(_mm256_cmp_ps(t, zero, _CMP_GE_OQ), _mm256_cmp_ps(t, one, _CMP_LE_OQ)));
+        mask = _mm256_and_ps(mask, _mm256_and_ps(_mm256_cmp_ps(u, zero, _CMP_GE_OQ), _mm256_cmp_ps(u, one, _CMP_LE_OQ)));
+        storeMask(mask, hit + i);
+    }
+    for (; i < count; ++i) {
+        hit[i] = scalar::intersectPair(s, a[i], b[i]);
+    }
+}
+
+AVX2_FUNCTION void overlapsRect(const Segments& s, const int* ids, size_t count,
+                                float minX, float minY, float maxX, float maxY, unsigned char* hit)
+{
+    const __m256 left = _mm256_set1_ps(minX), right = _mm256_set1_ps(maxX);
+    const __m256 bottom = _mm256_set1_ps(minY), top = _mm256_set1_ps(maxY);
+    const __m256 zero = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 x0 = gather(s.x0, ids + i), y0 = gather(s.y0, ids + i);
+        const __m256 x1 = gather(s.x1, ids + i), y1 = gather(s.y1, ids + i);
+
+        __m256 mask = _mm256_and_ps(_mm256_cmp_ps(_mm256_min_ps(x0, x1), right, _CMP_LE_OQ),
+                                    _mm256_cmp_ps(_mm256_max_ps(x0, x1), left, _CMP_GE_OQ));
+        mask = _mm256_and_ps(mask, _mm256_and_ps(_mm256_cmp_ps(_mm256_min_ps(y0, y1), top, _CMP_LE_OQ),
+                                                 _mm256_cmp_ps(_mm256_max_ps(y0, y1), bottom, _CMP_GE_OQ)));
+
+        const __m256 dx = _mm256_sub_ps(x1, x0);
+        const __m256 dy = _mm256_sub_ps(y1, y0);
+        const __m256 toLeft = _mm256_mul_ps(dy, _mm256_sub_ps(left, x0));
+        const __m256 toRight = _mm256_mul_ps(dy, _mm256_sub_ps(right, x0));
+        const __m256 toBottom = _mm256_mul_ps(dx, _mm256_sub_ps(bottom, y0));
+        const __m256 toTop = _mm256_mul_ps(dx, _mm256_sub_ps(top, y0));
+        const __m256 c0 = _mm256_sub_ps(toBottom, toLeft);
+        const __m256 c1 = _mm256_sub_ps(toBottom, toRight);
+        const __m256 c2 = _mm256_sub_ps(toTop, toRight);
+        const __m256 c3 = _mm256_sub_ps(toTop, toLeft);
+        const __m256 above = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(c0, zero, _CMP_GT_OQ), _mm256_cmp_ps(c1, zero, _CMP_GT_OQ)),
+                                           _mm256_and_ps(_mm256_cmp_ps(c2, zero, _CMP_GT_OQ), _mm256_cmp_ps(c3, zero, _CMP_GT_OQ)));
+        const __m256 below = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(c0, zero, _CMP_LT_OQ), _mm256_cmp_ps(c1, zero, _CMP_LT_OQ)),
+                                           _mm256_and_ps(_mm256_cmp_ps(c2, zero, _CMP_LT_OQ), _mm256_cmp_ps(c3, zero, _CMP_LT_OQ)));
+        storeMask(_mm256_andnot_ps(_mm256_or_ps(above, below), mask), hit + i);
+    }
+    for (; i < count; ++i) {
+        hit[i] = scalar::overlapsRect(s, ids[i], minX, minY, maxX, maxY);
+    }
+}
+
+} // namespace avx2
+
+bool cpuHasAvx2()
+{
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+
+    // The OS must save the YMM registers too
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) return false;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return false;
+#endif
+}
+
+#endif // GEOMETRY_KERNELS_X86
+
+InstructionSet bestSupported()
+{
+#ifdef GEOMETRY_KERNELS_X86
+    return cpuHasAvx2() ? InstructionSet::Avx2 : InstructionSet::Sse2;
+#else
+    return InstructionSet::Scalar;
+#endif
+}
+
+const InstructionSet supportedSet = bestSupported();
+std::atomic<InstructionSet> activeSet{supportedSet};
+
+} // namespace
+
+InstructionSet instructionSet()
+{
+    return activeSet.load(std::memory_order_relaxed);
+}
+
+const char* instructionSetName(InstructionSet set)
+{
+    switch (set) {
+        case InstructionSet::Avx2: return "avx2";
+        case InstructionSet::Sse2: return "sse2";
+        case InstructionSet::Scalar: break;
+    }
+    return "scalar";
+}
+
+void setInstructionSet(InstructionSet set)
+{
+    activeSet.store(set > supportedSet ? supportedSet : set, std::memory_order_relaxed);
+}
+
+void distanceSquared(const Segments& segments, const int* ids, size_t count, float px, float py, float* out)
+{
+    switch (instructionSet()) {
+#ifdef GEOMETRY_KERNELS_X86
+        case InstructionSet::Avx2: avx2::distanceSquared(segments, ids, count, px, py, out); return;
+        case InstructionSet::Sse2: sse2::distanceSquared(segments, ids, count, px, py, out); return;
+#endif
+        default: break;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = scalar::distanceSquared(segments, ids[i], px, py);
+    }
+}
+
+void project(const Segments& segments, const int* ids, size_t count, float px, float py,
+             float minLengthSquared, float* t, float* x, float* y)
+{
+    switch (instructionSet()) {
+#ifdef GEOMETRY_KERNELS_X86
+        case InstructionSet::Avx2: avx2::project(segments, ids, count, px, py, minLengthSquared, t, x, y); return;
+        case InstructionSet::Sse2: sse2::project(segments, ids, count, px, py, minLengthSquared, t, x, y); return;
+#endif
+        default: break;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        scalar::project(segments, ids[i], px, py, minLengthSquared, t[i], x[i], y[i]);
+    }
+}
+
+void pointDistances(const Segments& segments, const int* ids, size_t count, float px, float py,
+                    float* start, float* end, float* mid)
+{
+    switch (instructionSet()) {
+#ifdef GEOMETRY_KERNELS_X86
+        case InstructionSet::Avx2: avx2::pointDistances(segments, ids, count, px, py, start, end, mid); return;
+        case InstructionSet::Sse2: sse2::pointDistances(segments, ids, count, px, py, start, end, mid); return;
+#endif
+        default: break;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        scalar::pointDistances(segments, ids[i], px, py, start[i], end[i], mid[i]);
+    }
+}
+
+void intersectPairs(const Segments& segments, const int* a, const int* b, size_t count, unsigned char* hit)
+{
+    switch (instructionSet()) {
+#ifdef GEOMETRY_KERNELS_X86
+        case InstructionSet::Avx2: avx2::intersectPairs(segments, a, b, count, hit); return;
+        case InstructionSet::Sse2: sse2::intersectPairs(segments, a, b, count, hit); return;
+#endif
+        default: break;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        hit[i] = scalar::intersectPair(segments, a[i], b[i]);
+    }
+}
+
+void overlapsRect(const Segments& segments, const int* ids, size_t count,
+                  float minX, float minY, float maxX, float maxY, unsigned char* hit)
+{
+    switch (instructionSet()) {
+#ifdef GEOMETRY_KERNELS_X86
+        case InstructionSet::Avx2: avx2::overlapsRect(segments, ids, count, minX, minY, maxX, maxY, hit); return;
+        case InstructionSet::Sse2: sse2::overlapsRect(segments, ids, count, minX, minY, maxX, maxY, hit); return;
+#endif
+        default: break;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        hit[i] = scalar::overlapsRect(segments, ids[i], minX, minY, maxX, maxY);
+    }
+}
+
+} // namespace GeometryKernels
@@ -0,0 +1,294 @@
+#include "IntersectionIndex.h"
+#include "GeometryKernels.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// Candidate pairs gathered before running the batched crossing test
+const size_t pairBatch = 1024;
+
+struct Bounds {
+    float minX, maxX, minY, maxY;
+};
+
+Bounds lineBounds(const LineStore& lines, size_t i)
+{
+    return {lines.minX(i), lines.maxX(i), lines.minY(i), lines.maxY(i)};
+}
+
+// Cell width for the line grid: around the mean line length, so a line
+// touches a few cells and a cell holds a few lines, but never so fine that
+// the drawing spans more than about a thousand cells across
+float lineCellSize(const LineStore& lines)
+{
+    if (lines.size() == 0) return 1.0f;
+
+    double totalLength = 0.0;
+    float minX = std::numeric_limits<float>::max(), maxX = std::numeric_limits<float>::lowest();
+    float minY = std::numeric_limits<float>::max(), maxY = std::numeric_limits<float>::lowest();
+    for (size_t i = 0; i < lines.size(); ++i) {
+        totalLength += (lines.end(i) - lines.start(i)).length();
+        minX = std::min(minX, lines.minX(i));
+        maxX = std::max(maxX, lines.maxX(i));
+        minY = std::min(minY, lines.minY(i));
+        maxY = std::max(maxY, lines.maxY(i));
+    }
+    const double extent = std::max(static_cast<double>(maxX) - minX, static_cast<double>(maxY) - minY);
+    const double size = std::max({totalLength / lines.size(), extent / 1024.0, 1e-6});
+    return static_cast<float>(std::exp2(std::ceil(std::log2(size))));
+}
+
+bool nearPoint(const QVector2D& a, const QVector2D& b)
+{
+    // Relative tolerance so large survey coordinates behave like small ones
+    float scale = 1.0f + std::max(std::abs(a.x()), std::abs(a.y()));
+    return std::abs(a.x() - b.x()) <= 1e-5f * scale && std::abs(a.y() - b.y()) <= 1e-5f * scale;
+}
+
+} // namespace
+
+IntersectionIndex::IntersectionIndex()
+{
+}
+
+bool IntersectionIndex::findIntersection(const QVector2D& p1, const QVector2D& p2, const QVector2D& p3,
+                                         const QVector2D& p4, QVector2D& intersection)
+{
+    float x1 = p1.x(), y1 = p1.y();
+    float x2 = p2.x(), y2 = p2.y();
+    float x3 = p3.x(), y3 = p3.y();
+    float x4 = p4.x(), y4 = p4.y();
+
+    float denom = (x1 - x2) * (y3 - y4) - (y1 - y2) * (x3 - x4);
+    if (std::abs(denom) < 1e-6f)  // Lines are parallel
+        return false;
+
+    float t = ((x1 - x3) * (y3 - y4) - (y1 - y3) * (x3 - x4)) / denom;
+    float u = -((x1 - x2) * (y1 - y3) - (y1 - y2) * (x1 - x3)) / denom;
+
+    if (t >= 0 && t <= 1 && u >= 0 && u <= 1) {
+        intersection.setX(x1 + t * (x2 - x1));
+        intersection.setY(y1 + t * (y2 - y1));
+        return true;
+    }
+
+    return false;
+}
+
+void IntersectionIndex::clear()
+{
+    crossings.clear();
+    freeCrossings.clear();
+    lineCrossings.clear();
+    lineIndex.clear();
+    pointIndex.clear();
+    pending.clear();
+}
+
+void IntersectionIndex::setCellSize(float cellSize)
+{
+    pointIndex.setCellSize(cellSize);
+    for (size_t id = 0; id < crossings.size(); ++id) {
+        if (crossings[id].alive) {
+            pointIndex.insert(static_cast<int>(id), crossings[id].point, crossings[id].point);
+        }
+    }
+}
+
+void IntersectionIndex::build(const LineStore& lines, float cellSize)
+{
+    clear();
+    pointIndex.setCellSize(cellSize);
+    lineCrossings.resize(lines.size());
+
+    lineIndex.setCellSize(lineCellSize(lines));
+    for (size_t i = 0; i < lines.size(); ++i) {
+        lineIndex.insert(static_cast<int>(i), lines.start(i), lines.end(i));
+    }
+
+    // Each line is tested against the lower-numbered lines it shares grid
+    // cells with, so every pair is queued once; the cells near a line hold
+    // few others, where a sweep would keep every line spanning the sweep
+    // position active. Boxes that do not overlap cannot cross.
+    for (size_t i = 0; i < lines.size(); ++i) {
+        const int id = static_cast<int>(i);
+        const Bounds current = lineBounds(lines, i);
+        lineIndex.querySegment(lines.start(i), lines.end(i), scratch);
+        for (int other : scratch) {
+            if (other >= id) break;  // Ascending
+            if (lines.maxX(other) >= current.minX && lines.minX(other) <= current.maxX &&
+                lines.maxY(other) >= current.minY && lines.minY(other) <= current.maxY) {
+                queuePair(other, id, lines);
+            }
+        }
+    }
+    flushPairs(lines);
+}
+
+void IntersectionIndex::queuePair(int a, int b, const LineStore& lines)
+{
+    pairsA.push_back(a);
+    pairsB.push_back(b);
+    if (pairsA.size() >= pairBatch) {
+        flushPairs(lines);
+    }
+}
+
+void IntersectionIndex::flushPairs(const LineStore& lines)
+{
+    // Only pairs that cross go on to the full test, in the order queued
+    pairHits.resize(pairsA.size());
+    GeometryKernels::intersectPairs(GeometryKernels::columns(lines), pairsA.data(), pairsB.data(), pairsA.size(), pairHits.data());
+    for (size_t k = 0; k < pairsA.size(); ++k) {
+        if (pairHits[k]) {
+            testPair(pairsA[k], pairsB[k], lines);
+        }
+    }
+    pairsA.clear();
+    pairsB.clear();
+}
+
+void IntersectionIndex::testPair(int a, int b, const LineStore& lines)
+{
+    const QVector2D startA = lines.start(a);
+    const QVector2D endA = lines.end(a);
+    const QVector2D startB = lines.start(b);
+    const QVector2D endB = lines.end(b);
+
+    QVector2D intersection;
+    if (!findIntersection(startA, endA, startB, endB, intersection)) return;
+
+    if (nearPoint(intersection, startA) || nearPoint(intersection, endA) ||
+        nearPoint(intersection, startB) || nearPoint(intersection, endB)) {
+        return;
+    }
+    addCrossing(a, b, intersection);
+}
+
+void IntersectionIndex::addCrossing(int a, int b, const QVector2D& point)
+{
+    int id;
+    if (!freeCrossings.empty()) {
+        id = freeCrossings.back();
+        freeCrossings.pop_back();
+        crossings[id] = {point, a, b, true};
+    } else {
+        id = static_cast<int>(crossings.size());
+        crossings.push_back({point, a, b, true});
+    }
+
+    lineCrossings[a].push_back(id);
+    lineCrossings[b].push_back(id);
+    pointIndex.insert(id, point, point);
+}
+
+void IntersectionIndex::removeCrossing(int id)
+{
+    Crossing& crossing = crossings[id];
+    if (!crossing.alive) return;
+    crossing.alive = false;
+
+    for (int line : {crossing.lineA, crossing.lineB}) {
+        std::vector<int>& ids = lineCrossings[line];
+        auto pos = std::find(ids.begin(), ids.end(), id);
+        if (pos != ids.end()) {
+            *pos = ids.back();
+            ids.pop_back();
+        }
+    }
+    pointIndex.remove(id);
+    freeCrossings.push_back(id);
+}
+
+void IntersectionIndex::insertLines(const std::vector<int>& ids, const LineStore& lines)
+{
+    if (lineCrossings.size() < lines.size()) {
+        lineCrossings.resize(lines.size());
+    }
+    if (pending.size() < lines.size()) {
+        pending.resize(lines.size(), 0);
+    }
+    for (int id : ids) {
+        lineIndex.insert(id, lines.start(id), lines.end(id));
+        pending[id] = 1;
+    }
+
+    // A pair of lines that are both being inserted is tested once, by
+    // whichever of the two is processed last
+    for (int id : ids) {
+        lineIndex.querySegment(lines.start(id), lines.end(id), scratch);
+        for (int other : scratch) {
+            if (other == id || other >= static_cast<int>(lines.size()) || pending[other]) continue;
+            queuePair(std::min(id, other), std::max(id, other), lines);
+        }
+        pending[id] = 0;
+    }
+    flushPairs(lines);
+}
+
+void IntersectionIndex::removeLines(const std::vector<int>& ids)
+{
+    for (int id : ids) {
+        if (id < 0 || id >= static_cast<int>(lineCrossings.size())) continue;
+
+        // removeCrossing edits this list, so work on a copy
+        scratch = lineCrossings[id];
+        for (int crossing : scratch) {
+            removeCrossing(crossing);
+        }
+    }
+}
+
+void IntersectionIndex::eraseAndCompact(const std::vector<int>& sortedIds)
+{
+    if (sortedIds.empty()) return;
+
+    removeLines(sortedIds);
+    lineIndex.eraseAndCompact(sortedIds);
+
+    auto renumber = [&](int id) {
+        return id - static_cast<int>(std::lower_bound(sortedIds.begin(), sortedIds.end(), id) - sortedIds.begin());
+    };
+    for (Crossing& crossing : crossings) {
+        if (crossing.alive) {
+            crossing.lineA = renumber(crossing.lineA);
+            crossing.lineB = renumber(crossing.lineB);
+        }
+    }
+
+    size_t write = 0;
+    size_t next = 0;
+    for (size_t read = 0; read < lineCrossings.size(); ++read) {
+        if (next < sortedIds.size() && static_cast<size_t>(sortedIds[next]) == read) {
+            ++next;
+            continue;
+        }
+        if (write != read) {
+            lineCrossings[write] = std::move(lineCrossings[read]);
+        }
+        ++write;
+    }
+    lineCrossings.resize(write);
+}
+
+bool IntersectionIndex::nearest(const QVector2D& point, float radius, QVector2D& result, float& distance) const
+{
+    pointIndex.query(point, radius, candidates);
+
+    bool found = false;
+    float best = radius;
+    for (int id : candidates) {
+        float dist = (point - crossings[id].point).length();
+        if (dist < best) {
+            best = dist;
+            result = crossings[id].point;
+            found = true;
+        }
+    }
+    if (found) {
+        distance = best;
+    }
+    return found;
+}
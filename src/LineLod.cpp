@@ -0,0 +1,174 @@
+#include "LineLod.h"
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <utility>
+
+namespace {
+
+// The finest level has 2^gridBits cells per side; each coarser level halves
+// that, down to one cell over the whole drawing
+const int gridBits = 12;
+const int gridSize = 1 << gridBits;
+const int levelTotal = gridBits + 1;
+
+// Interleaves the bits of x and y, so dropping the low two bits of a key
+// gives the key of the enclosing cell one level up
+quint32 mortonKey(quint32 x, quint32 y)
+{
+    auto spread = [](quint32 v) {
+        v = (v | (v << 8)) & 0x00ff00ffu;
+        v = (v | (v << 4)) & 0x0f0f0f0fu;
+        v = (v | (v << 2)) & 0x33333333u;
+        v = (v | (v << 1)) & 0x55555555u;
+        return v;
+    };
+    return spread(x) | (spread(y) << 1);
+}
+
+typedef std::pair<quint32, quint32> CellEntry;  // Cell key, line
+
+// Collapses runs of equal keys in a key-sorted list to their lowest line
+void uniqueCells(std::vector<CellEntry>& cells)
+{
+    size_t write = 0;
+    for (size_t read = 0; read < cells.size(); ++read) {
+        if (write > 0 && cells[write - 1].first == cells[read].first) {
+            cells[write - 1].second = std::min(cells[write - 1].second, cells[read].second);
+        } else {
+            cells[write++] = cells[read];
+        }
+    }
+    cells.resize(write);
+}
+
+// Sorts by key in two 12-bit counting passes (keys have at most
+// 2 * gridBits bits). Stable, so equal keys keep their line order.
+void sortCells(std::vector<CellEntry>& cells, std::vector<CellEntry>& scratch)
+{
+    const int radixBits = gridBits;
+    const size_t buckets = size_t(1) << radixBits;
+    std::vector<size_t> offsets(buckets);
+    scratch.resize(cells.size());
+    for (int shift = 0; shift < 2 * gridBits; shift += radixBits) {
+        std::fill(offsets.begin(), offsets.end(), 0);
+        for (const CellEntry& cell : cells) {
+            ++offsets[(cell.first >> shift) & (buckets - 1)];
+        }
+        size_t total = 0;
+        for (size_t& offset : offsets) {
+            const size_t count = offset;
+            offset = total;
+            total += count;
+        }
+        for (const CellEntry& cell : cells) {
+            scratch[offsets[(cell.first >> shift) & (buckets - 1)]++] = cell;
+        }
+        cells.swap(scratch);
+    }
+}
+
+} // namespace
+
+void LineLod::clear()
+{
+    levels.clear();
+    orderedLines.clear();
+}
+
+void LineLod::build(const LineStore& lines)
+{
+    clear();
+    if (lines.empty()) return;
+
+    const size_t count = lines.size();
+    float minX = lines.minX(0), minY = lines.minY(0);
+    float maxX = lines.maxX(0), maxY = lines.maxY(0);
+    for (size_t i = 1; i < count; ++i) {
+        minX = std::min(minX, lines.minX(i));
+        minY = std::min(minY, lines.minY(i));
+        maxX = std::max(maxX, lines.maxX(i));
+        maxY = std::max(maxY, lines.maxY(i));
+    }
+    const float extent = std::max(std::max(maxX - minX, maxY - minY), 1e-6f);
+    const float baseCellSize = extent / gridSize;
+
+    // Level at which each line collapses (levelTotal: never), and where its
+    // midpoint falls in the finest grid
+    std::vector<unsigned char> collapseLevel(count);
+    std::vector<quint32> baseKeys(count);
+    std::vector<size_t> perLevel(levelTotal + 1, 0);
+    float cellSizes[levelTotal];
+    for (int level = 0; level < levelTotal; ++level) {
+        cellSizes[level] = baseCellSize * static_cast<float>(1 << level);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        const float length = std::max(std::fabs(lines.x1(i) - lines.x0(i)), std::fabs(lines.y1(i) - lines.y0(i)));
+        int level = 0;
+        for (int k = 0; k < levelTotal; ++k) {
+            level += length > cellSizes[k];
+        }
+        collapseLevel[i] = static_cast<unsigned char>(level);
+        ++perLevel[level];
+
+        const float midX = (lines.x0(i) + lines.x1(i)) * 0.5f;
+        const float midY = (lines.y0(i) + lines.y1(i)) * 0.5f;
+        const int cellX = std::min(std::max(static_cast<int>((midX - minX) / baseCellSize), 0), gridSize - 1);
+        const int cellY = std::min(std::max(static_cast<int>((midY - minY) / baseCellSize), 0), gridSize - 1);
+        baseKeys[i] = mortonKey(static_cast<quint32>(cellX), static_cast<quint32>(cellY));
+    }
+
+    // Counting sort by collapse level, latest first
+    std::vector<size_t> bucketStart(levelTotal + 1);
+    size_t offset = 0;
+    for (int level = levelTotal; level >= 0; --level) {
+        bucketStart[level] = offset;
+        offset += perLevel[level];
+    }
+    orderedLines.resize(count);
+    std::vector<size_t> fill = bucketStart;
+    for (size_t i = 0; i < count; ++i) {
+        orderedLines[fill[collapseLevel[i]]++] = static_cast<quint32>(i);
+    }
+
+    // Each level's cells are the previous level's, coarsened, plus the cells
+    // of the lines collapsing at this level
+    std::vector<CellEntry> cells, incoming, merged, scratch;
+    levels.resize(levelTotal);
+    for (int level = 0; level < levelTotal; ++level) {
+        for (CellEntry& cell : cells) {
+            cell.first >>= 2;
+        }
+        uniqueCells(cells);
+
+        incoming.clear();
+        for (size_t k = bucketStart[level]; k < bucketStart[level] + perLevel[level]; ++k) {
+            const quint32 line = orderedLines[k];
+            incoming.emplace_back(baseKeys[line] >> (2 * level), line);
+        }
+        sortCells(incoming, scratch);
+
+        merged.clear();
+        merged.reserve(cells.size() + incoming.size());
+        std::merge(cells.begin(), cells.end(), incoming.begin(), incoming.end(), std::back_inserter(merged));
+        uniqueCells(merged);
+        cells.swap(merged);
+
+        Level& entry = levels[level];
+        entry.cellSize = cellSizes[level];
+        entry.longLines = bucketStart[level];
+        entry.cells.resize(cells.size());
+        for (size_t c = 0; c < cells.size(); ++c) {
+            entry.cells[c] = cells[c].second;
+        }
+    }
+}
+
+int LineLod::levelFor(float cellSize) const
+{
+    int level = -1;
+    while (level + 1 < levelCount() && levels[level + 1].cellSize <= cellSize) {
+        ++level;
+    }
+    return level;
+}
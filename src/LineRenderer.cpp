@@ -0,0 +1,723 @@
+#include "LineRenderer.h"
+#include <QtGlobal>
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+
+namespace {
+
+// The fixed-function matrix stack set up in resizeGL/paintGL stays
+// authoritative, so the shader only forwards positions. Colour and
+// display flags come from the attribute texture: rgb is the line colour,
+// alpha holds the AttributeFlag bits.
+const char* lineVertexShader = R"(
+#version 120
+uniform sampler2D attributes;
+uniform vec2 attributeSize;
+attribute vec2 position;
+attribute float line;
+varying vec4 vColor;
+
+// Same as QColor::lighter(150): scale the HSV value and take the
+// overflow out of the saturation
+vec3 lighter(vec3 c)
+{
+    float v = max(max(c.r, c.g), c.b);
+    float m = min(min(c.r, c.g), c.b);
+    if (v <= 0.0) return c;
+    vec3 k = v > m ? (vec3(v) - c) / (v - m) : vec3(0.0);
+    float s = (v - m) / v;
+    float lv = v * 1.5;
+    if (lv > 1.0) {
+        s = max(0.0, s - (lv - 1.0));
+        lv = 1.0;
+    }
+    return vec3(lv) - s * lv * k;
+}
+
+void main()
+{
+    float row = floor(line / attributeSize.x);
+    vec2 texel = vec2(line - row * attributeSize.x, row) + 0.5;
+    vec4 attribute = texture2DLod(attributes, texel / attributeSize, 0.0);
+    float flags = floor(attribute.a * 255.0 + 0.5);
+
+    if (mod(floor(flags / 4.0), 2.0) > 0.5) {
+        // Hidden: both ends land outside the clip volume
+        vColor = vec4(0.0);
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+        return;
+    }
+
+    vec3 rgb = attribute.rgb;
+    if (mod(flags, 2.0) > 0.5) {
+        rgb = lighter(rgb);
+    }
+    if (mod(floor(flags / 2.0), 2.0) > 0.5) {
+        rgb = mix(rgb, vec3(1.0), 0.5);
+    }
+    vColor = vec4(rgb, 1.0);
+    gl_Position = gl_ModelViewProjectionMatrix * vec4(position, 0.0, 1.0);
+}
+)";
+
+const char* lineFragmentShader = R"(
+#version 120
+varying vec4 vColor;
+void main()
+{
+    gl_FragColor = vColor;
+}
+)";
+
+const int positionAttribute = 0;
+const int lineAttribute = 1;
+
+// Grow the buffer geometrically so a stream of addLine calls does not
+// reallocate on every line
+const size_t minimumCapacity = 1024;
+
+// Lines per attribute texture row. A power of two keeps the row/column
+// split in the shader exact.
+const size_t attributeRowLength = 4096;
+
+// Below this many lines drawing them all is cheap enough
+const size_t lodMinimumLines = 100000;
+
+// Selected lines drawn over the level of detail. A larger selection covers
+// much of the drawing, and drawing it line by line would cost what the
+// collapse saves; its cells' points still show the selected representatives.
+const size_t lodHighlightLimit = 100000;
+
+size_t roundUpToRows(size_t lines)
+{
+    return std::max<size_t>(1, (lines + attributeRowLength - 1) / attributeRowLength) * attributeRowLength;
+}
+
+} // namespace
+
+LineRenderer::LineRenderer()
+    : vertexBuffer(QOpenGLBuffer::VertexBuffer)
+    , indexBuffer(QOpenGLBuffer::IndexBuffer)
+    , attributeTexture(0)
+    , initialized(false)
+    , syncedVersion(0)
+    , uploadedLines(0)
+    , capacityLines(0)
+    , fullUpload(true)
+    , attributesDirty(false)
+    , hoveredLine(-1)
+    , lodVersion(0)
+    , lodPointBuffer(QOpenGLBuffer::VertexBuffer)
+    , lodIndexBuffer(QOpenGLBuffer::IndexBuffer)
+    , lodBuilding(false)
+{
+}
+
+LineRenderer::~LineRenderer()
+{
+    // GL objects must be released through cleanup() while the context is current
+    joinLevelOfDetail();
+}
+
+void LineRenderer::initialize()
+{
+    initializeOpenGLFunctions();
+
+    program.addShaderFromSourceCode(QOpenGLShader::Vertex, lineVertexShader);
+    program.addShaderFromSourceCode(QOpenGLShader::Fragment, lineFragmentShader);
+    program.bindAttributeLocation("position", positionAttribute);
+    program.bindAttributeLocation("line", lineAttribute);
+    if (!program.link()) {
+        // isAvailable() stays false and the caller draws the lines itself
+        qWarning("LineRenderer: line shader failed to link, falling back to immediate mode:\n%s",
+                 qPrintable(program.log()));
+        return;
+    }
+
+    vertexBuffer.create();
+    vertexBuffer.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+    indexBuffer.create();
+    indexBuffer.setUsagePattern(QOpenGLBuffer::StreamDraw);
+    lodPointBuffer.create();
+    lodIndexBuffer.create();
+    lod.clear();
+
+    glGenTextures(1, &attributeTexture);
+    glBindTexture(GL_TEXTURE_2D, attributeTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // VAOs are optional on compatibility contexts; fall back to binding
+    // the attributes on every draw when they are not available
+    if (vao.create()) {
+        vao.bind();
+        vertexBuffer.bind();
+        setupAttributes();
+        vao.release();
+        vertexBuffer.release();
+    }
+
+    // uploadedLines still describes the attribute mirror, which outlives
+    // the context; only the GPU copies have to be rebuilt
+    initialized = true;
+    capacityLines = 0;
+    fullUpload = true;
+}
+
+void LineRenderer::cleanup()
+{
+    // No ready callback may run once the owner starts going away
+    joinLevelOfDetail();
+
+    if (vao.isCreated()) {
+        vao.destroy();
+    }
+    vertexBuffer.destroy();
+    indexBuffer.destroy();
+    lodPointBuffer.destroy();
+    lodIndexBuffer.destroy();
+    if (attributeTexture != 0) {
+        glDeleteTextures(1, &attributeTexture);
+        attributeTexture = 0;
+    }
+    program.removeAllShaders();
+    initialized = false;
+}
+
+void LineRenderer::invalidateAll()
+{
+    fullUpload = true;
+    dirtyRanges.clear();
+}
+
+void LineRenderer::packLine(const LineStore& lines, size_t index, Vertex* out)
+{
+    const float line = static_cast<float>(index);
+    out[0] = {lines.x0(index), lines.y0(index), line};
+    out[1] = {lines.x1(index), lines.y1(index), line};
+}
+
+void LineRenderer::setupAttributes()
+{
+    glEnableVertexAttribArray(positionAttribute);
+    glVertexAttribPointer(positionAttribute, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+                          reinterpret_cast<const void*>(offsetof(Vertex, x)));
+    glEnableVertexAttribArray(lineAttribute);
+    glVertexAttribPointer(lineAttribute, 1, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+                          reinterpret_cast<const void*>(offsetof(Vertex, line)));
+}
+
+void LineRenderer::reallocate(const LineStore& lines)
+{
+    capacityLines = roundUpToRows(std::max(minimumCapacity, lines.size() + lines.size() / 2));
+
+    staging.resize(lines.size() * 2);
+    for (size_t i = 0; i < lines.size(); ++i) {
+        packLine(lines, i, &staging[i * 2]);
+    }
+
+    vertexBuffer.bind();
+    vertexBuffer.allocate(static_cast<int>(capacityLines * 2 * sizeof(Vertex)));
+    if (!staging.empty()) {
+        vertexBuffer.write(0, staging.data(), static_cast<int>(staging.size() * sizeof(Vertex)));
+    }
+    vertexBuffer.release();
+
+    // The texture is resized along with the buffer and gets the whole mirror
+    attributes.resize(capacityLines);
+    glBindTexture(GL_TEXTURE_2D, attributeTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, static_cast<GLsizei>(attributeRowLength),
+                 static_cast<GLsizei>(capacityLines / attributeRowLength), 0,
+                 GL_RGBA, GL_UNSIGNED_BYTE, attributes.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+    dirtyRows.assign(capacityLines / attributeRowLength, false);
+    attributesDirty = false;
+
+    uploadedLines = lines.size();
+    fullUpload = false;
+    dirtyRanges.clear();
+}
+
+void LineRenderer::resetAttributes(const LineStore& lines)
+{
+    attributes.assign(roundUpToRows(lines.size()), LineAttributes{0, 0, 0, 0});
+    recolourRanges.assign(1, {0, lines.size()});
+    selectedLines.clear();
+    hoveredLine = -1;
+}
+
+void LineRenderer::eraseAttributes(const std::vector<int>& sortedIndices, size_t lineCount)
+{
+    if (sortedIndices.empty()) return;
+    const size_t first = sortedIndices.front();
+
+    // Lines from the first removed one on change index; drop their
+    // selection and hover so the next setSelection()/setHovered() starts
+    // from a consistent state. Hidden lines stay hidden as they move.
+    auto shifted = std::lower_bound(selectedLines.begin(), selectedLines.end(), static_cast<int>(first));
+    for (auto it = shifted; it != selectedLines.end(); ++it) {
+        if (static_cast<size_t>(*it) < lineCount) {
+            attributes[*it].flags &= ~Selected;
+        }
+    }
+    selectedLines.erase(shifted, selectedLines.end());
+    if (hoveredLine >= static_cast<int>(first)) {
+        if (static_cast<size_t>(hoveredLine) < lineCount) {
+            attributes[hoveredLine].flags &= ~Hovered;
+        }
+        hoveredLine = -1;
+    }
+
+    size_t write = first;
+    size_t next = 0;
+    for (size_t read = first; read < lineCount; ++read) {
+        if (next < sortedIndices.size() && static_cast<size_t>(sortedIndices[next]) == read) {
+            ++next;
+            continue;
+        }
+        attributes[write++] = attributes[read];
+    }
+    std::fill(attributes.begin() + write, attributes.begin() + lineCount, LineAttributes{0, 0, 0, 0});
+}
+
+void LineRenderer::markAttributeRows(size_t first, size_t last)
+{
+    if (first >= last) return;
+
+    const size_t lastRow = (last - 1) / attributeRowLength;
+    if (lastRow >= dirtyRows.size()) {
+        dirtyRows.resize(lastRow + 1, false);
+    }
+    for (size_t row = first / attributeRowLength; row <= lastRow; ++row) {
+        dirtyRows[row] = true;
+    }
+    attributesDirty = true;
+}
+
+void LineRenderer::setFlag(size_t index, unsigned char flag, bool on)
+{
+    if (index >= uploadedLines) return;
+
+    unsigned char& flags = attributes[index].flags;
+    const unsigned char updated = on ? (flags | flag) : (flags & ~flag);
+    if (updated != flags) {
+        flags = updated;
+        markAttributeRows(index, index + 1);
+    }
+}
+
+void LineRenderer::setSelection(const std::vector<int>& sortedIndices)
+{
+    if (sortedIndices == selectedLines) return;
+
+    for (int index : selectedLines) {
+        setFlag(index, Selected, false);
+    }
+    for (int index : sortedIndices) {
+        setFlag(index, Selected, true);
+    }
+    selectedLines = sortedIndices;
+}
+
+void LineRenderer::setHovered(int index)
+{
+    if (index == hoveredLine) return;
+
+    if (hoveredLine >= 0) {
+        setFlag(hoveredLine, Hovered, false);
+    }
+    hoveredLine = index;
+    if (hoveredLine >= 0) {
+        setFlag(hoveredLine, Hovered, true);
+    }
+}
+
+void LineRenderer::setHidden(const std::vector<int>& indices, bool hidden)
+{
+    for (int index : indices) {
+        setFlag(index, Hidden, hidden);
+    }
+}
+
+void LineRenderer::uploadAttributes()
+{
+    if (!attributesDirty) return;
+
+    // Consecutive dirty rows go up in one call
+    const size_t rows = std::min(dirtyRows.size(), capacityLines / attributeRowLength);
+    glBindTexture(GL_TEXTURE_2D, attributeTexture);
+    size_t row = 0;
+    while (row < rows) {
+        if (!dirtyRows[row]) {
+            ++row;
+            continue;
+        }
+        size_t end = row;
+        while (end < rows && dirtyRows[end]) {
+            ++end;
+        }
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, static_cast<GLint>(row),
+                        static_cast<GLsizei>(attributeRowLength), static_cast<GLsizei>(end - row),
+                        GL_RGBA, GL_UNSIGNED_BYTE, &attributes[row * attributeRowLength]);
+        row = end;
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    std::fill(dirtyRows.begin(), dirtyRows.end(), false);
+    attributesDirty = false;
+}
+
+void LineRenderer::sync(const Document& document)
+{
+    if (!initialized) return;
+
+    const LineStore& lines = document.lines();
+
+    // Turn the document's edits into stale line ranges. The attribute
+    // mirror is replayed even when the geometry is re-uploaded anyway, so
+    // display state survives a context loss.
+    bool resetState = false;
+    if (syncedVersion != document.version()) {
+        resetState = !document.changesSince(syncedVersion, changes);
+        size_t lineCount = uploadedLines;
+        for (size_t c = 0; c < changes.size() && !resetState; ++c) {
+            const DocumentChange* change = changes[c];
+            switch (change->type) {
+                case DocumentChange::LinesAdded:
+                    dirtyRanges.insert(dirtyRanges.end(), change->ranges.begin(), change->ranges.end());
+                    recolourRanges.insert(recolourRanges.end(), change->ranges.begin(), change->ranges.end());
+                    lineCount = std::max(lineCount, change->ranges.back().second);
+                    if (lineCount > attributes.size()) {
+                        attributes.resize(roundUpToRows(lineCount), LineAttributes{0, 0, 0, 0});
+                    }
+                    break;
+                case DocumentChange::LinesModified:
+                    // Colour-only edits never touch the vertex buffer
+                    if (change->geometryChanged) {
+                        dirtyRanges.insert(dirtyRanges.end(), change->ranges.begin(), change->ranges.end());
+                    }
+                    recolourRanges.insert(recolourRanges.end(), change->ranges.begin(), change->ranges.end());
+                    break;
+                case DocumentChange::LinesRemoved:
+                    // Everything after the first removed line has shifted down
+                    eraseAttributes(change->removed, lineCount);
+                    lineCount -= change->removed.size();
+                    dirtyRanges.emplace_back(change->removed.front(), std::numeric_limits<size_t>::max());
+                    recolourRanges.emplace_back(change->removed.front(), std::numeric_limits<size_t>::max());
+                    break;
+                case DocumentChange::LinesReset:
+                    resetState = true;
+                    break;
+            }
+        }
+    }
+    syncedVersion = document.version();
+
+    if (resetState) {
+        resetAttributes(lines);
+        fullUpload = true;
+    }
+    if (attributes.size() < lines.size()) {
+        attributes.resize(roundUpToRows(lines.size()), LineAttributes{0, 0, 0, 0});
+    }
+
+    // Refresh colours in the mirror; flags are left alone
+    for (const auto& range : recolourRanges) {
+        const size_t last = std::min(range.second, lines.size());
+        for (size_t i = range.first; i < last; ++i) {
+            const QRgb rgba = lines.rgba(i);
+            attributes[i].r = static_cast<unsigned char>(qRed(rgba));
+            attributes[i].g = static_cast<unsigned char>(qGreen(rgba));
+            attributes[i].b = static_cast<unsigned char>(qBlue(rgba));
+        }
+        markAttributeRows(range.first, last);
+    }
+    recolourRanges.clear();
+
+    if (fullUpload || lines.size() > capacityLines || attributes.size() > capacityLines) {
+        reallocate(lines);
+        return;
+    }
+
+    if (!dirtyRanges.empty()) {
+        // Merge overlapping/adjacent ranges so each contiguous run is written once
+        std::sort(dirtyRanges.begin(), dirtyRanges.end());
+
+        auto upload = [&](size_t first, size_t last) {
+            last = std::min(last, lines.size());
+            if (first >= last) return;
+
+            staging.resize((last - first) * 2);
+            for (size_t i = first; i < last; ++i) {
+                packLine(lines, i, &staging[(i - first) * 2]);
+            }
+            vertexBuffer.write(static_cast<int>(first * 2 * sizeof(Vertex)), staging.data(),
+                               static_cast<int>(staging.size() * sizeof(Vertex)));
+        };
+
+        vertexBuffer.bind();
+        size_t runFirst = dirtyRanges.front().first;
+        size_t runLast = dirtyRanges.front().second;
+        for (size_t i = 1; i < dirtyRanges.size(); ++i) {
+            if (dirtyRanges[i].first <= runLast) {
+                runLast = std::max(runLast, dirtyRanges[i].second);
+            } else {
+                upload(runFirst, runLast);
+                runFirst = dirtyRanges[i].first;
+                runLast = dirtyRanges[i].second;
+            }
+        }
+        upload(runFirst, runLast);
+        vertexBuffer.release();
+
+        dirtyRanges.clear();
+    }
+
+    uploadedLines = lines.size();
+}
+
+void LineRenderer::beginDraw()
+{
+    uploadAttributes();
+
+    program.bind();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, attributeTexture);
+    program.setUniformValue("attributes", 0);
+    program.setUniformValue("attributeSize", static_cast<GLfloat>(attributeRowLength),
+                            static_cast<GLfloat>(capacityLines / attributeRowLength));
+}
+
+void LineRenderer::endDraw()
+{
+    glBindTexture(GL_TEXTURE_2D, 0);
+    program.release();
+}
+
+void LineRenderer::bindLines()
+{
+    if (vao.isCreated()) {
+        vao.bind();
+    } else {
+        vertexBuffer.bind();
+        setupAttributes();
+    }
+}
+
+void LineRenderer::releaseLines()
+{
+    if (vao.isCreated()) {
+        vao.release();
+    } else {
+        glDisableVertexAttribArray(positionAttribute);
+        glDisableVertexAttribArray(lineAttribute);
+        vertexBuffer.release();
+    }
+}
+
+void LineRenderer::draw()
+{
+    if (!initialized || capacityLines == 0 || uploadedLines == 0) return;
+
+    beginDraw();
+    bindLines();
+    glDrawArrays(GL_LINES, 0, static_cast<GLsizei>(uploadedLines * 2));
+    releaseLines();
+    endDraw();
+}
+
+void LineRenderer::draw(const std::vector<int>& visibleLines)
+{
+    // Past half of the document, building and uploading the index list
+    // costs more than drawing the rest
+    if (visibleLines.size() * 2 > uploadedLines) {
+        draw();
+        return;
+    }
+    drawLines(visibleLines, GL_LINES);
+}
+
+void LineRenderer::drawLines(const std::vector<int>& lineIndices, GLenum mode)
+{
+    if (!initialized || capacityLines == 0 || lineIndices.empty()) return;
+
+    visibleIndices.clear();
+    visibleIndices.reserve(lineIndices.size() * 2);
+    for (int line : lineIndices) {
+        if (static_cast<size_t>(line) >= uploadedLines) continue;
+        visibleIndices.push_back(static_cast<GLuint>(line) * 2);
+        visibleIndices.push_back(static_cast<GLuint>(line) * 2 + 1);
+    }
+
+    beginDraw();
+    bindLines();
+    // Bound after the VAO, whose state includes the element buffer
+    indexBuffer.bind();
+    indexBuffer.allocate(visibleIndices.data(), static_cast<int>(visibleIndices.size() * sizeof(GLuint)));
+    glDrawElements(mode, static_cast<GLsizei>(visibleIndices.size()), GL_UNSIGNED_INT, nullptr);
+    indexBuffer.release();
+    releaseLines();
+    endDraw();
+}
+
+void LineRenderer::drawHovered(int index)
+{
+    setHovered(index);
+    if (index < 0) return;
+
+    // Endpoints as well, so a sub-pixel line still shows
+    hoveredLines.assign(1, index);
+    drawLines(hoveredLines, GL_LINES);
+    drawLines(hoveredLines, GL_POINTS);
+}
+
+void LineRenderer::buildLevelOfDetail(const LineStore& lines, LevelOfDetail& out)
+{
+    out.lod.build(lines);
+
+    // Points sit at the midpoint of their cell's line and carry its index,
+    // so colour and display flags come from the attribute texture as usual
+    out.pointOffsets.assign(1, 0);
+    for (int level = 0; level < out.lod.levelCount(); ++level) {
+        for (quint32 line : out.lod.cellLines(level)) {
+            out.points.push_back({(lines.x0(line) + lines.x1(line)) * 0.5f,
+                                  (lines.y0(line) + lines.y1(line)) * 0.5f,
+                                  static_cast<float>(line)});
+        }
+        out.pointOffsets.push_back(out.points.size());
+    }
+
+    // Every level draws a prefix of the same ordering
+    const size_t longLines = out.lod.levelCount() > 0 ? out.lod.longLineCount(0) : 0;
+    out.lineIndices.resize(longLines * 2);
+    for (size_t i = 0; i < longLines; ++i) {
+        out.lineIndices[i * 2] = out.lod.linesByLevel()[i] * 2;
+        out.lineIndices[i * 2 + 1] = out.lod.linesByLevel()[i] * 2 + 1;
+    }
+}
+
+void LineRenderer::followLevelOfDetail(const Document& document)
+{
+    // Take over a finished rebuild. It may already be out of date again,
+    // but its extent still tells zoomed-in views apart.
+    std::unique_ptr<LevelOfDetail> finished;
+    if (lodBuilding) {
+        std::lock_guard<std::mutex> lock(lodMutex);
+        finished = std::move(lodFinished);
+    }
+    if (finished) {
+        joinLevelOfDetail();
+        lod = std::move(finished->lod);
+        lodPointOffsets = std::move(finished->pointOffsets);
+        lodVersion = finished->version;
+
+        lodPointBuffer.bind();
+        lodPointBuffer.allocate(finished->points.data(), static_cast<int>(finished->points.size() * sizeof(Vertex)));
+        lodPointBuffer.release();
+        lodIndexBuffer.bind();
+        lodIndexBuffer.allocate(finished->lineIndices.data(),
+                                static_cast<int>(finished->lineIndices.size() * sizeof(GLuint)));
+        lodIndexBuffer.release();
+    }
+
+    // Colour and display changes come from the attribute texture; only
+    // geometry edits call for a rebuild
+    if (lod.levelCount() == 0 || lodVersion == document.version()) return;
+    if (!document.changesSince(lodVersion, changes)) return;
+    for (const DocumentChange* change : changes) {
+        if (change->geometryChanged) return;
+    }
+    lodVersion = document.version();
+}
+
+void LineRenderer::startLevelOfDetail(const Document& document)
+{
+    if (lodBuilding) return;  // The frame after it lands asks again if needed
+
+    // The worker reads its own copy, so the document stays free to change;
+    // copying is a fraction of the build
+    lodBuilding = true;
+    lodThread = std::thread([this, lines = document.lines(), version = document.version()]() {
+        auto built = std::make_unique<LevelOfDetail>();
+        built->version = version;
+        buildLevelOfDetail(lines, *built);
+        {
+            std::lock_guard<std::mutex> lock(lodMutex);
+            lodFinished = std::move(built);
+        }
+        if (lodReady) lodReady();
+    });
+}
+
+void LineRenderer::joinLevelOfDetail()
+{
+    if (lodThread.joinable()) {
+        lodThread.join();
+    }
+    lodBuilding = false;
+}
+
+void LineRenderer::waitForLevelOfDetail()
+{
+    if (lodThread.joinable()) {
+        lodThread.join();
+    }
+}
+
+bool LineRenderer::drawLevelOfDetail(const Document& document, float worldPerPixel)
+{
+    if (!initialized || capacityLines == 0 || uploadedLines < lodMinimumLines) return false;
+
+    followLevelOfDetail(document);
+
+    // Until a current hierarchy arrives the caller draws the lines in view.
+    // A stale one still knows the drawing's rough extent; no rebuild while
+    // it says the view is zoomed in too far to use it.
+    if (lod.levelCount() == 0 || lodVersion != document.version()) {
+        if (lod.levelCount() == 0 || lod.levelFor(worldPerPixel) >= 0) {
+            startLevelOfDetail(document);
+        }
+        return false;
+    }
+    const int level = lod.levelFor(worldPerPixel);
+    if (level < 0) return false;
+
+    beginDraw();
+
+    // Lines longer than a cell, straight from the retained buffer
+    const size_t longLines = lod.longLineCount(level);
+    if (longLines > 0) {
+        bindLines();
+        lodIndexBuffer.bind();
+        glDrawElements(GL_LINES, static_cast<GLsizei>(longLines * 2), GL_UNSIGNED_INT, nullptr);
+        lodIndexBuffer.release();
+        releaseLines();
+    }
+
+    // One point per occupied cell for everything shorter
+    lodPointBuffer.bind();
+    setupAttributes();
+    glDrawArrays(GL_POINTS, static_cast<GLint>(lodPointOffsets[level]),
+                 static_cast<GLsizei>(lodPointOffsets[level + 1] - lodPointOffsets[level]));
+    glDisableVertexAttribArray(positionAttribute);
+    glDisableVertexAttribArray(lineAttribute);
+    lodPointBuffer.release();
+
+    endDraw();
+
+    // Selected and hovered lines as they are, endpoints included so a
+    // sub-pixel line still covers a pixel
+    highlightLines.clear();
+    if (selectedLines.size() <= lodHighlightLimit) {
+        highlightLines = selectedLines;
+    }
+    if (hoveredLine >= 0) {
+        highlightLines.push_back(hoveredLine);
+    }
+    drawLines(highlightLines, GL_LINES);
+    drawLines(highlightLines, GL_POINTS);
+    return true;
+}
@@ -0,0 +1,82 @@
+#include "LineStore.h"
+
+void LineStore::reserve(size_t count)
+{
+    x0s.reserve(count);
+    y0s.reserve(count);
+    x1s.reserve(count);
+    y1s.reserve(count);
+    colors.reserve(count);
+}
+
+void LineStore::clear()
+{
+    x0s.clear();
+    y0s.clear();
+    x1s.clear();
+    y1s.clear();
+    colors.clear();
+}
+
+void LineStore::push_back(const Line& line)
+{
+    push_back(line.start.x(), line.start.y(), line.end.x(), line.end.y(), line.color.rgba());
+}
+
+void LineStore::push_back(float x0, float y0, float x1, float y1, QRgb rgba)
+{
+    x0s.push_back(x0);
+    y0s.push_back(y0);
+    x1s.push_back(x1);
+    y1s.push_back(y1);
+    colors.push_back(rgba);
+}
+
+void LineStore::append(const LineStore& other)
+{
+    x0s.insert(x0s.end(), other.x0s.begin(), other.x0s.end());
+    y0s.insert(y0s.end(), other.y0s.begin(), other.y0s.end());
+    x1s.insert(x1s.end(), other.x1s.begin(), other.x1s.end());
+    y1s.insert(y1s.end(), other.y1s.begin(), other.y1s.end());
+    colors.insert(colors.end(), other.colors.begin(), other.colors.end());
+}
+
+void LineStore::translate(size_t i, float dx, float dy)
+{
+    x0s[i] += dx;
+    y0s[i] += dy;
+    x1s[i] += dx;
+    y1s[i] += dy;
+}
+
+void LineStore::setGeometry(size_t i, float x0, float y0, float x1, float y1)
+{
+    x0s[i] = x0;
+    y0s[i] = y0;
+    x1s[i] = x1;
+    y1s[i] = y1;
+}
+
+void LineStore::eraseSorted(const std::vector<int>& sortedIndices)
+{
+    if (sortedIndices.empty()) return;
+
+    // Same pass over every column, so they stay aligned
+    auto compact = [&](auto& column) {
+        size_t write = sortedIndices.front();
+        size_t next = 0;
+        for (size_t read = write; read < column.size(); ++read) {
+            if (next < sortedIndices.size() && static_cast<size_t>(sortedIndices[next]) == read) {
+                ++next;
+                continue;
+            }
+            column[write++] = column[read];
+        }
+        column.erase(column.begin() + write, column.end());
+    };
+    compact(x0s);
+    compact(y0s);
+    compact(x1s);
+    compact(y1s);
+    compact(colors);
+}
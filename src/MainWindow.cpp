@@ -26,6 +26,7 @@ MainWindow::MainWindow(QWidget *parent)
     createActions();    // Add this first
     createMenus();
     createToolbars();  // Add toolbar creation - this now handles all connections
+    createSnapActions();
     // Remove setupConnections() call
 }
 
@@ -185,6 +186,53 @@ void MainWindow::createActions()
     editMenu->addAction(colorAction);
 }
 
+void MainWindow::createSnapActions()
+{
+    // Same actions in the menu and on the toolbar, so both show the state
+    QMenu* snapMenu = menuBar()->addMenu(tr("&Snap"));
+    QToolBar* snapToolbar = addToolBar(tr("Snap"));
+
+    const std::pair<const char*, unsigned> modes[] = {
+        {QT_TR_NOOP("Endpoint"), SnapManager::SnapEndpoint},
+        {QT_TR_NOOP("Intersection"), SnapManager::SnapIntersection},
+        {QT_TR_NOOP("Midpoint"), SnapManager::SnapMidpoint},
+        {QT_TR_NOOP("Perpendicular"), SnapManager::SnapPerpendicular},
+        {QT_TR_NOOP("Nearest"), SnapManager::SnapNearest},
+    };
+    for (const auto& mode : modes) {
+        QAction* action = new QAction(tr(mode.first), this);
+        action->setCheckable(true);
+        action->setChecked((glWidget->snapModes() & mode.second) != 0);
+        connect(action, &QAction::toggled, this, &MainWindow::onSnapModesChanged);
+        snapMenu->addAction(action);
+        snapToolbar->addAction(action);
+        snapModeActions.emplace_back(action, mode.second);
+    }
+
+    snapMenu->addSeparator();
+    QAction* weldAction = snapMenu->addAction(tr("&Weld Endpoints"));
+    weldAction->setCheckable(true);
+    weldAction->setChecked(glWidget->weldsEndpoints());
+    weldAction->setStatusTip(tr("Join new line endpoints to existing ones they almost touch"));
+    connect(weldAction, &QAction::toggled, this, &MainWindow::onWeldEndpointsToggled);
+}
+
+void MainWindow::onSnapModesChanged()
+{
+    unsigned modes = 0;
+    for (const auto& entry : snapModeActions) {
+        if (entry.first->isChecked()) {
+            modes |= entry.second;
+        }
+    }
+    glWidget->setSnapModes(modes);
+}
+
+void MainWindow::onWeldEndpointsToggled(bool enabled)
+{
+    glWidget->setWeldEndpoints(enabled);
+}
+
 void MainWindow::showColorDialog()
 {
     QColor color = QColorDialog::getColor(glWidget->getCurrentColor(), this);
@@ -0,0 +1,439 @@
+#include "RTree.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// Entries per node; 16 keeps a node's boxes within a few cache lines
+const size_t maxEntries = 16;
+
+// Parent value of nodes on the free list
+const int freeNodeMarker = -2;
+
+RTree::Box emptyBox()
+{
+    const float inf = std::numeric_limits<float>::infinity();
+    return {inf, inf, -inf, -inf};
+}
+
+void expand(RTree::Box& box, const RTree::Box& other)
+{
+    box.minX = std::min(box.minX, other.minX);
+    box.minY = std::min(box.minY, other.minY);
+    box.maxX = std::max(box.maxX, other.maxX);
+    box.maxY = std::max(box.maxY, other.maxY);
+}
+
+float area(const RTree::Box& box)
+{
+    return (box.maxX - box.minX) * (box.maxY - box.minY);
+}
+
+float centerX(const RTree::Box& box) { return box.minX + box.maxX; }
+float centerY(const RTree::Box& box) { return box.minY + box.maxY; }
+
+// Inclusive, like QRectF::contains on the edges
+bool overlaps(const RTree::Box& box, const QRectF& rect)
+{
+    return box.minX <= rect.right() && box.maxX >= rect.left() &&
+           box.minY <= rect.bottom() && box.maxY >= rect.top();
+}
+
+bool inside(const RTree::Box& box, const QRectF& rect)
+{
+    return box.minX >= rect.left() && box.maxX <= rect.right() &&
+           box.minY >= rect.top() && box.maxY <= rect.bottom();
+}
+
+} // namespace
+
+RTree::RTree()
+    : root(-1)
+    , count(0)
+{
+}
+
+void RTree::clear()
+{
+    nodes.clear();
+    freeNodes.clear();
+    leafOf.clear();
+    root = -1;
+    count = 0;
+}
+
+int RTree::allocateNode(bool leaf, int parent)
+{
+    int node;
+    if (!freeNodes.empty()) {
+        node = freeNodes.back();
+        freeNodes.pop_back();
+    } else {
+        node = static_cast<int>(nodes.size());
+        nodes.emplace_back();
+    }
+    nodes[node].entries.clear();
+    nodes[node].parent = parent;
+    nodes[node].leaf = leaf;
+    return node;
+}
+
+void RTree::freeNode(int node)
+{
+    nodes[node].entries.clear();
+    nodes[node].parent = freeNodeMarker;
+    freeNodes.push_back(node);
+}
+
+RTree::Box RTree::nodeBox(int node) const
+{
+    Box box = emptyBox();
+    for (const Entry& entry : nodes[node].entries) {
+        expand(box, entry.box);
+    }
+    return box;
+}
+
+void RTree::build(const std::vector<Box>& boxes)
+{
+    clear();
+    leafOf.assign(boxes.size(), -1);
+    count = boxes.size();
+    if (boxes.empty()) return;
+
+    std::vector<Entry> entries(boxes.size());
+    for (size_t i = 0; i < boxes.size(); ++i) {
+        entries[i] = {boxes[i], static_cast<int>(i)};
+    }
+    root = buildLevel(entries, true);
+}
+
+int RTree::buildLevel(std::vector<Entry>& entries, bool leaf)
+{
+    // Sort-tile-recursive packing: cut the entries into vertical slices by
+    // x, then fill nodes from each slice in y order. Repeat one level up
+    // until a single node remains.
+    while (true) {
+        if (entries.size() <= maxEntries) {
+            int node = allocateNode(leaf, -1);
+            nodes[node].entries = std::move(entries);
+            for (const Entry& entry : nodes[node].entries) {
+                if (leaf) leafOf[entry.id] = node;
+                else nodes[entry.id].parent = node;
+            }
+            return node;
+        }
+
+        size_t nodeCount = (entries.size() + maxEntries - 1) / maxEntries;
+        size_t sliceCount = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(nodeCount))));
+        size_t sliceSize = sliceCount * maxEntries;
+
+        std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+            return centerX(a.box) < centerX(b.box);
+        });
+
+        std::vector<Entry> parents;
+        parents.reserve(nodeCount);
+        for (size_t slice = 0; slice < entries.size(); slice += sliceSize) {
+            auto sliceEnd = entries.begin() + std::min(slice + sliceSize, entries.size());
+            std::sort(entries.begin() + slice, sliceEnd, [](const Entry& a, const Entry& b) {
+                return centerY(a.box) < centerY(b.box);
+            });
+
+            for (auto first = entries.begin() + slice; first < sliceEnd; first += maxEntries) {
+                auto last = std::min(first + maxEntries, sliceEnd);
+                int node = allocateNode(leaf, -1);
+                nodes[node].entries.assign(first, last);
+                for (const Entry& entry : nodes[node].entries) {
+                    if (leaf) leafOf[entry.id] = node;
+                    else nodes[entry.id].parent = node;
+                }
+                parents.push_back({nodeBox(node), node});
+            }
+        }
+
+        entries = std::move(parents);
+        leaf = false;
+    }
+}
+
+int RTree::chooseLeaf(const Box& box) const
+{
+    // Descend into the child that grows least to take the box
+    int node = root;
+    while (!nodes[node].leaf) {
+        const std::vector<Entry>& entries = nodes[node].entries;
+        int best = entries.front().id;
+        float bestGrowth = std::numeric_limits<float>::max();
+        float bestArea = std::numeric_limits<float>::max();
+        for (const Entry& entry : entries) {
+            Box grown = entry.box;
+            expand(grown, box);
+            float entryArea = area(entry.box);
+            float growth = area(grown) - entryArea;
+            if (growth < bestGrowth || (growth == bestGrowth && entryArea < bestArea)) {
+                best = entry.id;
+                bestGrowth = growth;
+                bestArea = entryArea;
+            }
+        }
+        node = best;
+    }
+    return node;
+}
+
+void RTree::insert(int id, const Box& box)
+{
+    if (id < 0) return;
+    if (static_cast<size_t>(id) >= leafOf.size()) {
+        leafOf.resize(id + 1, -1);
+    }
+    if (leafOf[id] >= 0) {
+        remove(id);
+    }
+    if (root < 0) {
+        root = allocateNode(true, -1);
+    }
+
+    int leaf = chooseLeaf(box);
+    nodes[leaf].entries.push_back({box, id});
+    leafOf[id] = leaf;
+    ++count;
+
+    if (nodes[leaf].entries.size() > maxEntries) {
+        splitNode(leaf);
+    } else {
+        refreshUpward(leaf);
+    }
+}
+
+void RTree::splitNode(int node)
+{
+    std::vector<Entry> all = std::move(nodes[node].entries);
+
+    // Split at the median along the axis that gives the smaller halves
+    auto halvesPerimeter = [&]() {
+        Box first = emptyBox();
+        Box second = emptyBox();
+        for (size_t i = 0; i < all.size(); ++i) {
+            expand(i < all.size() / 2 ? first : second, all[i].box);
+        }
+        return (first.maxX - first.minX) + (first.maxY - first.minY) +
+               (second.maxX - second.minX) + (second.maxY - second.minY);
+    };
+    std::sort(all.begin(), all.end(), [](const Entry& a, const Entry& b) {
+        return centerY(a.box) < centerY(b.box);
+    });
+    float byY = halvesPerimeter();
+    std::sort(all.begin(), all.end(), [](const Entry& a, const Entry& b) {
+        return centerX(a.box) < centerX(b.box);
+    });
+    if (byY < halvesPerimeter()) {
+        std::sort(all.begin(), all.end(), [](const Entry& a, const Entry& b) {
+            return centerY(a.box) < centerY(b.box);
+        });
+    }
+
+    const size_t half = all.size() / 2;
+    const bool leaf = nodes[node].leaf;
+    int sibling = allocateNode(leaf, nodes[node].parent);
+    nodes[node].entries.assign(all.begin(), all.begin() + half);
+    nodes[sibling].entries.assign(all.begin() + half, all.end());
+    for (const Entry& entry : nodes[sibling].entries) {
+        if (leaf) leafOf[entry.id] = sibling;
+        else nodes[entry.id].parent = sibling;
+    }
+
+    int parent = nodes[node].parent;
+    if (parent < 0) {
+        // The root split; grow the tree by one level
+        int newRoot = allocateNode(false, -1);
+        nodes[newRoot].entries.push_back({nodeBox(node), node});
+        nodes[newRoot].entries.push_back({nodeBox(sibling), sibling});
+        nodes[node].parent = newRoot;
+        nodes[sibling].parent = newRoot;
+        root = newRoot;
+        return;
+    }
+
+    for (Entry& entry : nodes[parent].entries) {
+        if (entry.id == node) {
+            entry.box = nodeBox(node);
+            break;
+        }
+    }
+    nodes[parent].entries.push_back({nodeBox(sibling), sibling});
+    if (nodes[parent].entries.size() > maxEntries) {
+        splitNode(parent);
+    } else {
+        refreshUpward(parent);
+    }
+}
+
+void RTree::refreshUpward(int node)
+{
+    while (nodes[node].parent >= 0) {
+        int parent = nodes[node].parent;
+        Box box = nodeBox(node);
+        for (Entry& entry : nodes[parent].entries) {
+            if (entry.id == node) {
+                entry.box = box;
+                break;
+            }
+        }
+        node = parent;
+    }
+}
+
+void RTree::remove(int id)
+{
+    if (id < 0 || static_cast<size_t>(id) >= leafOf.size() || leafOf[id] < 0) return;
+
+    int leaf = leafOf[id];
+    std::vector<Entry>& entries = nodes[leaf].entries;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (entries[i].id == id) {
+            entries[i] = entries.back();
+            entries.pop_back();
+            break;
+        }
+    }
+    leafOf[id] = -1;
+    --count;
+
+    if (count == 0) {
+        nodes.clear();
+        freeNodes.clear();
+        root = -1;
+    } else if (entries.empty() && leaf != root) {
+        removeEmptyNode(leaf);
+    } else {
+        refreshUpward(leaf);
+    }
+}
+
+void RTree::removeEmptyNode(int node)
+{
+    int parent = nodes[node].parent;
+    std::vector<Entry>& entries = nodes[parent].entries;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (entries[i].id == node) {
+            entries[i] = entries.back();
+            entries.pop_back();
+            break;
+        }
+    }
+    freeNode(node);
+
+    if (entries.empty() && parent != root) {
+        removeEmptyNode(parent);
+        return;
+    }
+    refreshUpward(parent);
+
+    // Drop root levels that are down to a single child
+    while (!nodes[root].leaf && nodes[root].entries.size() == 1) {
+        int child = nodes[root].entries.front().id;
+        freeNode(root);
+        root = child;
+        nodes[root].parent = -1;
+    }
+}
+
+void RTree::update(int id, const Box& box)
+{
+    // A box that stays within its leaf's bounds is replaced in place; the
+    // boxes above may end up a little loose, which queries tolerate
+    if (id >= 0 && static_cast<size_t>(id) < leafOf.size() && leafOf[id] >= 0) {
+        int leaf = leafOf[id];
+        int parent = nodes[leaf].parent;
+        bool fits = parent < 0;
+        for (size_t i = 0; !fits && i < nodes[parent].entries.size(); ++i) {
+            const Entry& entry = nodes[parent].entries[i];
+            if (entry.id == leaf) {
+                fits = box.minX >= entry.box.minX && box.maxX <= entry.box.maxX &&
+                       box.minY >= entry.box.minY && box.maxY <= entry.box.maxY;
+                break;
+            }
+        }
+        if (fits) {
+            for (Entry& entry : nodes[leaf].entries) {
+                if (entry.id == id) {
+                    entry.box = box;
+                    return;
+                }
+            }
+        }
+    }
+
+    remove(id);
+    insert(id, box);
+}
+
+void RTree::eraseAndCompact(const std::vector<int>& sortedIds)
+{
+    if (sortedIds.empty()) return;
+
+    for (int id : sortedIds) {
+        remove(id);
+    }
+
+    auto renumber = [&](int id) {
+        return id - static_cast<int>(std::lower_bound(sortedIds.begin(), sortedIds.end(), id) - sortedIds.begin());
+    };
+    for (Node& node : nodes) {
+        if (node.leaf && node.parent != freeNodeMarker) {
+            for (Entry& entry : node.entries) {
+                entry.id = renumber(entry.id);
+            }
+        }
+    }
+
+    size_t write = 0;
+    size_t next = 0;
+    for (size_t read = 0; read < leafOf.size(); ++read) {
+        if (next < sortedIds.size() && static_cast<size_t>(sortedIds[next]) == read) {
+            ++next;
+            continue;
+        }
+        leafOf[write++] = leafOf[read];
+    }
+    leafOf.resize(write);
+}
+
+void RTree::collect(int node, std::vector<int>& out) const
+{
+    for (const Entry& entry : nodes[node].entries) {
+        if (nodes[node].leaf) {
+            out.push_back(entry.id);
+        } else {
+            collect(entry.id, out);
+        }
+    }
+}
+
+void RTree::query(const QRectF& rect, std::vector<int>& inside, std::vector<int>* overlapping) const
+{
+    if (root < 0) return;
+    queryNode(root, rect, rect.width() > 0 && rect.height() > 0, inside, overlapping);
+}
+
+void RTree::queryNode(int node, const QRectF& rect, bool canContain, std::vector<int>& insideIds,
+                      std::vector<int>* overlapping) const
+{
+    const bool leaf = nodes[node].leaf;
+    for (const Entry& entry : nodes[node].entries) {
+        if (!overlaps(entry.box, rect)) continue;
+
+        if (canContain && inside(entry.box, rect)) {
+            // Everything below lies inside too
+            if (leaf) insideIds.push_back(entry.id);
+            else collect(entry.id, insideIds);
+        } else if (!leaf) {
+            queryNode(entry.id, rect, canContain, insideIds, overlapping);
+        } else if (overlapping) {
+            overlapping->push_back(entry.id);
+        }
+    }
+}
@@ -0,0 +1,205 @@
+#include "Selection.h"
+#include "GeometryKernels.h"
+#include <algorithm>
+
+namespace {
+
+RTree::Box lineBox(const LineStore& lines, size_t i)
+{
+    return {lines.minX(i), lines.minY(i), lines.maxX(i), lines.maxY(i)};
+}
+
+// Appends 'ids' to 'out' in ascending order. Large results, such as a window
+// around the whole drawing, are ordered by marking them over the index range
+// instead of sorting.
+void appendAscending(const std::vector<int>& ids, size_t lineCount, std::vector<int>& out, std::vector<char>& marks)
+{
+    if (ids.size() < lineCount / 32) {
+        const size_t first = out.size();
+        out.insert(out.end(), ids.begin(), ids.end());
+        std::sort(out.begin() + first, out.end());
+        return;
+    }
+
+    marks.assign(lineCount, 0);
+    for (int id : ids) {
+        marks[id] = 1;
+    }
+    for (size_t i = 0; i < lineCount; ++i) {
+        if (marks[i]) out.push_back(static_cast<int>(i));
+    }
+}
+
+} // namespace
+
+Selection::Selection(const Document& document)
+    : document(document)
+    , syncedVersion(0)
+    , treeValid(false)
+{
+}
+
+void Selection::rebuildTree()
+{
+    const LineStore& lines = document.lines();
+    std::vector<RTree::Box> boxes(lines.size());
+    for (size_t i = 0; i < lines.size(); ++i) {
+        boxes[i] = lineBox(lines, i);
+    }
+    tree.build(boxes);
+    treeValid = true;
+}
+
+void Selection::syncWithDocument()
+{
+    if (treeValid && syncedVersion == document.version()) return;
+
+    if (treeValid && !document.changesSince(syncedVersion, changes)) {
+        treeValid = false;
+    }
+
+    // Boxes are taken from the current lines, which later edits in the batch
+    // may have moved or shifted; collect the touched ids and refresh them once
+    // the whole batch is replayed
+    const LineStore& lines = document.lines();
+    for (size_t c = 0; c < changes.size() && treeValid; ++c) {
+        const DocumentChange* change = changes[c];
+        switch (change->type) {
+            case DocumentChange::LinesAdded:
+                for (const auto& range : change->ranges) {
+                    for (size_t i = range.first; i < range.second; ++i) {
+                        tree.insert(static_cast<int>(i), i < lines.size() ? lineBox(lines, i) : RTree::Box{});
+                        staleBoxes.push_back(static_cast<int>(i));
+                    }
+                }
+                break;
+            case DocumentChange::LinesModified:
+                // Colour-only edits leave the boxes untouched
+                if (!change->geometryChanged) break;
+                for (const auto& range : change->ranges) {
+                    for (size_t i = range.first; i < range.second; ++i) {
+                        staleBoxes.push_back(static_cast<int>(i));
+                    }
+                }
+                break;
+            case DocumentChange::LinesRemoved: {
+                // Bulk loading beats removing a large share one entry at a time
+                if (change->removed.size() > tree.size() / 4) {
+                    treeValid = false;
+                    break;
+                }
+                const std::vector<int>& removed = change->removed;
+                tree.eraseAndCompact(removed);
+                size_t write = 0;
+                for (int id : staleBoxes) {
+                    auto it = std::lower_bound(removed.begin(), removed.end(), id);
+                    if (it != removed.end() && *it == id) continue;
+                    staleBoxes[write++] = id - static_cast<int>(it - removed.begin());
+                }
+                staleBoxes.resize(write);
+                break;
+            }
+            case DocumentChange::LinesReset:
+                treeValid = false;
+                break;
+        }
+    }
+    changes.clear();
+
+    if (!treeValid) {
+        rebuildTree();
+    } else if (!staleBoxes.empty()) {
+        std::sort(staleBoxes.begin(), staleBoxes.end());
+        staleBoxes.erase(std::unique(staleBoxes.begin(), staleBoxes.end()), staleBoxes.end());
+        for (int id : staleBoxes) {
+            if (static_cast<size_t>(id) < lines.size()) {
+                tree.update(id, lineBox(lines, id));
+            }
+        }
+    }
+    staleBoxes.clear();
+    syncedVersion = document.version();
+}
+
+int Selection::pickLine(const QVector2D& point, float radius)
+{
+    syncWithDocument();
+
+    // Pad the search box a little so float rounding in the distance test
+    // cannot accept a line the box query left out
+    const double reach = radius * 1.001 + 1e-6;
+    inside.clear();
+    candidates.clear();
+    tree.query(QRectF(point.x() - reach, point.y() - reach, 2 * reach, 2 * reach), inside, &candidates);
+    candidates.insert(candidates.end(), inside.begin(), inside.end());
+
+    // Zero-length lines come out as NaN and therefore never pick
+    distances.resize(candidates.size());
+    GeometryKernels::distanceSquared(GeometryKernels::columns(document.lines()), candidates.data(), candidates.size(),
+                                     point.x(), point.y(), distances.data());
+
+    // Lowest index wins, as when scanning the lines in order
+    const float radiusSquared = radius * radius;
+    int best = -1;
+    for (size_t k = 0; k < candidates.size(); ++k) {
+        if ((best == -1 || candidates[k] < best) && distances[k] <= radiusSquared) {
+            best = candidates[k];
+        }
+    }
+    return best;
+}
+
+void Selection::selectInRect(const QRectF& worldRect, bool crossing, std::vector<int>& out)
+{
+    syncWithDocument();
+
+    const QRectF searchRect = worldRect.normalized();
+    inside.clear();
+
+    if (!crossing) {
+        // A box inside the rectangle means both endpoints are; nothing else can be
+        tree.query(searchRect, inside, nullptr);
+        appendAscending(inside, document.size(), out, marks);
+        return;
+    }
+
+    // The overlap test runs on the rectangle rounded to float. When that is
+    // the same rectangle (it is for rectangles dragged on screen), boxes
+    // inside it hold selected lines outright; otherwise search the union of
+    // both rectangles and test every line found.
+    const float minX = static_cast<float>(searchRect.left());
+    const float minY = static_cast<float>(searchRect.top());
+    const float maxX = static_cast<float>(searchRect.right());
+    const float maxY = static_cast<float>(searchRect.bottom());
+    const QRectF edgeRect(QPointF(minX, minY), QPointF(maxX, maxY));
+    const bool sameEdges = edgeRect.left() == searchRect.left() && edgeRect.right() == searchRect.right() &&
+                           edgeRect.top() == searchRect.top() && edgeRect.bottom() == searchRect.bottom();
+    candidates.clear();
+    tree.query(sameEdges ? searchRect : searchRect.united(edgeRect), inside, &candidates);
+    if (!sameEdges) {
+        candidates.insert(candidates.end(), inside.begin(), inside.end());
+        inside.clear();
+    }
+
+    // Select lines that touch the rectangle: an endpoint inside or a
+    // crossing with one of its edges. Hits join 'inside'.
+    const LineStore& lines = document.lines();
+    hits.resize(candidates.size());
+    GeometryKernels::overlapsRect(GeometryKernels::columns(lines), candidates.data(), candidates.size(),
+                                  minX, minY, maxX, maxY, hits.data());
+    for (size_t k = 0; k < candidates.size(); ++k) {
+        if (hits[k]) {
+            inside.push_back(candidates[k]);
+        }
+    }
+    appendAscending(inside, lines.size(), out, marks);
+}
+
+void Selection::linesInRect(const QRectF& worldRect, std::vector<int>& out)
+{
+    syncWithDocument();
+
+    // Inside or merely overlapping makes no difference here
+    out.clear();
+    tree.query(worldRect.normalized(), out, &out);
+}
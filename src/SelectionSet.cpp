@@ -0,0 +1,103 @@
+#include "SelectionSet.h"
+#include <QtAlgorithms>
+
+SelectionSet::SelectionSet()
+    : count(0)
+    , listValid(true)
+{
+}
+
+void SelectionSet::clear()
+{
+    bits.clear();
+    list.clear();
+    count = 0;
+    listValid = true;
+}
+
+void SelectionSet::insert(int index)
+{
+    if (index < 0 || contains(index)) return;
+
+    const size_t word = static_cast<size_t>(index) >> 6;
+    if (word >= bits.size()) {
+        bits.resize(word + 1, 0);
+    }
+    bits[word] |= quint64(1) << (index & 63);
+    ++count;
+
+    // Appending in ascending order keeps the list usable as is
+    if (listValid && (list.empty() || index > list.back())) {
+        list.push_back(index);
+    } else {
+        listValid = false;
+    }
+}
+
+void SelectionSet::remove(int index)
+{
+    if (!contains(index)) return;
+
+    bits[static_cast<size_t>(index) >> 6] &= ~(quint64(1) << (index & 63));
+    --count;
+
+    if (listValid && index == list.back()) {
+        list.pop_back();
+    } else {
+        listValid = false;
+    }
+}
+
+void SelectionSet::assign(const std::vector<int>& indices)
+{
+    clear();
+    unite(indices);
+}
+
+void SelectionSet::unite(const std::vector<int>& indices)
+{
+    for (int index : indices) {
+        insert(index);
+    }
+}
+
+void SelectionSet::subtract(const std::vector<int>& indices)
+{
+    for (int index : indices) {
+        remove(index);
+    }
+}
+
+void SelectionSet::invert(size_t lineCount)
+{
+    const size_t words = (lineCount + 63) / 64;
+    bits.resize(words, 0);
+
+    count = 0;
+    for (size_t i = 0; i < words; ++i) {
+        bits[i] = ~bits[i];
+        count += qPopulationCount(bits[i]);
+    }
+    // Clear the bits past the last line
+    if (lineCount % 64 != 0) {
+        const quint64 tail = bits.back() & ~((quint64(1) << (lineCount % 64)) - 1);
+        count -= qPopulationCount(tail);
+        bits.back() &= ~tail;
+    }
+    listValid = false;
+}
+
+const std::vector<int>& SelectionSet::indices() const
+{
+    if (!listValid) {
+        list.clear();
+        list.reserve(count);
+        for (size_t i = 0; i < bits.size(); ++i) {
+            for (quint64 word = bits[i]; word != 0; word &= word - 1) {
+                list.push_back(static_cast<int>(i * 64 + qCountTrailingZeroBits(word)));
+            }
+        }
+        listValid = true;
+    }
+    return list;
+}
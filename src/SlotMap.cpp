@@ -0,0 +1,66 @@
+#include "SlotMap.h"
+#include <algorithm>
+
+EntityHandle SlotMap::handleAt(size_t index) const
+{
+    const quint32 position = static_cast<quint32>(index);
+    auto found = slotOfIndex.find(position);
+    if (found != slotOfIndex.end()) {
+        return {found->second, slotTable[found->second].generation};
+    }
+
+    quint32 slot;
+    if (!freeSlots.empty()) {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+        slotTable[slot].index = position;
+    } else {
+        slot = static_cast<quint32>(slotTable.size());
+        slotTable.push_back({position, 0});
+    }
+    slotOfIndex.emplace(position, slot);
+    return {slot, slotTable[slot].generation};
+}
+
+void SlotMap::releaseSlot(quint32 slot)
+{
+    slotTable[slot].index = freeIndex;
+    ++slotTable[slot].generation;
+    freeSlots.push_back(slot);
+}
+
+EntityHandle SlotMap::push_back()
+{
+    return handleAt(entityCount++);
+}
+
+void SlotMap::reset(size_t count)
+{
+    for (const auto& entry : slotOfIndex) {
+        releaseSlot(entry.second);
+    }
+    slotOfIndex.clear();
+    entityCount = count;
+}
+
+void SlotMap::eraseSorted(const std::vector<int>& sortedIndices)
+{
+    if (sortedIndices.empty()) return;
+    entityCount -= sortedIndices.size();
+
+    // Release the removed entities' slots and point the others at their
+    // shifted positions
+    std::unordered_map<quint32, quint32> shifted;
+    shifted.reserve(slotOfIndex.size());
+    for (const auto& entry : slotOfIndex) {
+        auto below = std::lower_bound(sortedIndices.begin(), sortedIndices.end(), static_cast<int>(entry.first));
+        if (below != sortedIndices.end() && *below == static_cast<int>(entry.first)) {
+            releaseSlot(entry.second);
+            continue;
+        }
+        const quint32 position = entry.first - static_cast<quint32>(below - sortedIndices.begin());
+        slotTable[entry.second].index = position;
+        shifted.emplace(position, entry.second);
+    }
+    slotOfIndex.swap(shifted);
+}
@@ -1,14 +1,37 @@
 #include "SnapManager.h"
 #include "Line.h"
+#include "GeometryKernels.h"
 #include <GL/gl.h>
 #include <algorithm> // For std::clamp
+#include <cmath>
+#include <limits>
 #define _USE_MATH_DEFINES
 #include <math.h>
 
-SnapManager::SnapManager(float snapThreshold, float zoomLevel, const std::vector<Line>& lines)
+namespace {
+
+// Guard region around the cached candidates, as a fraction of the snap
+// radius. Wider means fewer grid searches but more candidates per query.
+const float candidateGuard = 0.5f;
+
+} // namespace
+
+SnapManager::SnapManager(float snapThreshold, float zoomLevel, const Document& document)
     : snapThreshold(snapThreshold)
     , zoom(zoomLevel)
-    , lines(lines)  // Copy the lines
+    , document(document)
+    , modes(AllSnapModes)
+    , hasReferencePoint(false)
+    , syncedVersion(document.version())
+    , lineIndexValid(false)
+    , intersectionsValid(false)
+    , candidatesValid(false)
+    , cacheRadius(0.0f)
+    , guardRadius(0.0f)
+    , cacheVersion(0)
+    , memoValid(false)
+    , memoActive(false)
+    , memoType(SNAP_NONE)
     , currentSnapPoint(0.0f, 0.0f)
     , snapActive(false)
     , currentSnapType(SNAP_NONE)
@@ -23,80 +46,135 @@ SnapManager::~SnapManager()
 
 QVector2D SnapManager::snapPoint(const QVector2D& point)
 {
-    QVector2D closestPoint = point;
     float baseThreshold = snapThreshold * 5.0f;  // Reduced from 10.0f
     float effectiveThreshold = baseThreshold / zoom;
-    float minDistance = std::numeric_limits<float>::max();
-    
+
     snapActive = false;
     currentSnapType = SNAP_NONE;
+    currentSnapPoint = point;
+    if (modes == 0) return currentSnapPoint;
+
+    // Only lines passing through the grid cells around the cursor can snap
+    syncWithDocument();
+    ensureIndices(effectiveThreshold);
+    updateCandidates(point, effectiveThreshold);
+    if (memoValid && point == memoPoint) {
+        snapActive = memoActive;
+        currentSnapType = memoType;
+        currentSnapPoint = memoSnapPoint;
+        return currentSnapPoint;
+    }
+
+    (this->*kernels[modes])(point, effectiveThreshold);
+
+    memoValid = true;
+    memoPoint = point;
+    memoSnapPoint = currentSnapPoint;
+    memoActive = snapActive;
+    memoType = currentSnapType;
+    return currentSnapPoint;
+}
+
+template <unsigned Modes>
+void SnapManager::snapKernel(const QVector2D& point, float effectiveThreshold)
+{
+    const LineStore& lines = document.lines();
+    const GeometryKernels::Segments segments = GeometryKernels::columns(lines);
+    const size_t count = candidates.size();
+    const float thresholdSquared = effectiveThreshold * effectiveThreshold;
+    QVector2D closestPoint = point;
+    float minDistanceSquared = std::numeric_limits<float>::max();
+
+    // Three result columns, one float per candidate each
+    scratch.resize(count * 3);
+    float* const first = scratch.data();
+    float* const second = first + count;
+    float* const third = second + count;
+
+    // Endpoint and midpoint distances come out of one pass over the lines
+    if constexpr ((Modes & (SnapEndpoint | SnapMidpoint)) != 0) {
+        GeometryKernels::pointDistances(segments, candidates.data(), count, point.x(), point.y(), first, second, third);
+    }
 
     // Check endpoints first (highest priority)
-    for (const auto& line : lines) {
-        float startDist = (point - line.start).length();
-        float endDist = (point - line.end).length();
-        
-        if (startDist < effectiveThreshold && startDist < minDistance) {
-            minDistance = startDist;
-            closestPoint = line.start;
-            snapActive = true;
-            currentSnapType = SNAP_ENDPOINT;
+    if constexpr ((Modes & SnapEndpoint) != 0) {
+        for (size_t k = 0; k < count; ++k) {
+            if (first[k] < thresholdSquared && first[k] < minDistanceSquared) {
+                minDistanceSquared = first[k];
+                closestPoint = lines.start(candidates[k]);
+                snapActive = true;
+                currentSnapType = SNAP_ENDPOINT;
+            }
+            if (second[k] < thresholdSquared && second[k] < minDistanceSquared) {
+                minDistanceSquared = second[k];
+                closestPoint = lines.end(candidates[k]);
+                snapActive = true;
+                currentSnapType = SNAP_ENDPOINT;
+            }
         }
-        if (endDist < effectiveThreshold && endDist < minDistance) {
-            minDistance = endDist;
-            closestPoint = line.end;
-            snapActive = true;
-            currentSnapType = SNAP_ENDPOINT;
+    }
+
+    // Check intersections second (if no endpoint found) against the
+    // precomputed crossing points
+    if constexpr ((Modes & SnapIntersection) != 0) {
+        if (!snapActive) {
+            QVector2D intersection;
+            float dist;
+            if (intersections.nearest(point, effectiveThreshold, intersection, dist) && dist * dist < minDistanceSquared) {
+                minDistanceSquared = dist * dist;
+                closestPoint = intersection;
+                snapActive = true;
+                currentSnapType = SNAP_INTERSECTION;
+            }
         }
     }
 
-    // Check intersections second (if no endpoint found)
-    if (!snapActive) {
-        for (size_t i = 0; i < lines.size(); i++) {
-            for (size_t j = i + 1; j < lines.size(); j++) {
-                QVector2D intersection;
-                if (findIntersection(lines[i], lines[j], intersection)) {
-                    float dist = (point - intersection).length();
-                    if (dist < effectiveThreshold && dist < minDistance) {
-                        minDistance = dist;
-                        closestPoint = intersection;
-                        snapActive = true;
-                        currentSnapType = SNAP_INTERSECTION;
-                    }
+    // If no endpoint found, check midpoints
+    if constexpr ((Modes & SnapMidpoint) != 0) {
+        if (!snapActive) {
+            for (size_t k = 0; k < count; ++k) {
+                if (third[k] < thresholdSquared && third[k] < minDistanceSquared) {
+                    minDistanceSquared = third[k];
+                    closestPoint = (lines.start(candidates[k]) + lines.end(candidates[k])) * 0.5f;
+                    snapActive = true;
+                    currentSnapType = SNAP_MIDPOINT;
                 }
             }
         }
     }
 
-    // If no endpoint found, check midpoints
-    if (!snapActive) {
-        for (const auto& line : lines) {
-            QVector2D midpoint = (line.start + line.end) * 0.5f;
-            float midDist = (point - midpoint).length();
-            if (midDist < effectiveThreshold && midDist < minDistance) {
-                minDistance = midDist;
-                closestPoint = midpoint;
-                snapActive = true;
-                currentSnapType = SNAP_MIDPOINT;
+    // Feet of the perpendiculars dropped from the reference point
+    if constexpr ((Modes & SnapPerpendicular) != 0) {
+        if (!snapActive && hasReferencePoint) {
+            GeometryKernels::project(segments, candidates.data(), count, referencePoint.x(), referencePoint.y(),
+                                     1e-6f, first, second, third);
+            for (size_t k = 0; k < count; ++k) {
+                if (first[k] > 0.0f && first[k] < 1.0f) {
+                    const QVector2D foot(second[k], third[k]);
+                    const float footDistSquared = (point - foot).lengthSquared();
+                    if (footDistSquared < thresholdSquared && footDistSquared < minDistanceSquared) {
+                        minDistanceSquared = footDistSquared;
+                        closestPoint = foot;
+                        snapActive = true;
+                        currentSnapType = SNAP_PERPENDICULAR;
+                    }
+                }
             }
         }
     }
 
     // Finally check line projections with the widest threshold
-    if (!snapActive) {
-        for (const auto& line : lines) {
-            QVector2D ab = line.end - line.start;
-            float ab_length_squared = ab.lengthSquared();
-            
-            if (ab_length_squared > 1e-6f) {
-                QVector2D ap = point - line.start;
-                float t = QVector2D::dotProduct(ap, ab) / ab_length_squared;
-                
-                if (t > 0.0f && t < 1.0f) {
-                    QVector2D projection = line.start + ab * t;
-                    float projDist = (point - projection).length();
-                    if (projDist < effectiveThreshold && projDist < minDistance) {
-                        minDistance = projDist;
+    if constexpr ((Modes & SnapNearest) != 0) {
+        if (!snapActive) {
+            GeometryKernels::project(segments, candidates.data(), count, point.x(), point.y(),
+                                     1e-6f, first, second, third);
+            for (size_t k = 0; k < count; ++k) {
+                // NaN for degenerate lines fails the range test
+                if (first[k] > 0.0f && first[k] < 1.0f) {
+                    const QVector2D projection(second[k], third[k]);
+                    const float projDistSquared = (point - projection).lengthSquared();
+                    if (projDistSquared < thresholdSquared && projDistSquared < minDistanceSquared) {
+                        minDistanceSquared = projDistSquared;
                         closestPoint = projection;
                         snapActive = true;
                         currentSnapType = SNAP_LINE;
@@ -107,14 +185,77 @@ QVector2D SnapManager::snapPoint(const QVector2D& point)
     }
 
     currentSnapPoint = closestPoint;
-    return currentSnapPoint;
 }
 
-void SnapManager::updateSettings(float newSnapThreshold, float newZoom, const std::vector<Line>& newLines)
+template <size_t... Masks>
+constexpr std::array<SnapManager::Kernel, sizeof...(Masks)> SnapManager::makeKernels(std::index_sequence<Masks...>)
+{
+    return {{&SnapManager::snapKernel<static_cast<unsigned>(Masks)>...}};
+}
+
+const std::array<SnapManager::Kernel, SnapManager::AllSnapModes + 1> SnapManager::kernels =
+    SnapManager::makeKernels(std::make_index_sequence<SnapManager::AllSnapModes + 1>());
+
+void SnapManager::setSnapModes(unsigned newModes)
+{
+    newModes &= AllSnapModes;
+    if (newModes == modes) return;
+
+    // Turning intersections back on rebuilds their index on the next query
+    if ((newModes & SnapIntersection) == 0) {
+        intersections.clear();
+        intersectionsValid = false;
+    }
+    modes = newModes;
+    memoValid = false;
+}
+
+void SnapManager::setReferencePoint(const QVector2D& point)
+{
+    if (hasReferencePoint && point == referencePoint) return;
+    referencePoint = point;
+    hasReferencePoint = true;
+    memoValid = false;
+}
+
+void SnapManager::clearReferencePoint()
+{
+    if (!hasReferencePoint) return;
+    hasReferencePoint = false;
+    memoValid = false;
+}
+
+void SnapManager::updateCandidates(const QVector2D& point, float radius)
+{
+    if (candidatesValid && cacheVersion == document.version() && cacheRadius == radius &&
+        (point - cacheCenter).lengthSquared() <= guardRadius * guardRadius) {
+        return;
+    }
+
+    // A line within 'radius' of a point inside the guard region has its
+    // box within 'reach' of the center, so the pruned set still holds all
+    // of them, in the ascending order the grid returns
+    guardRadius = radius * candidateGuard;
+    const float reach = radius + guardRadius;
+    lineIndex.query(point, reach, candidates);
+
+    const LineStore& lines = document.lines();
+    candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [&](int index) {
+        return lines.minX(index) > point.x() + reach || lines.maxX(index) < point.x() - reach ||
+               lines.minY(index) > point.y() + reach || lines.maxY(index) < point.y() - reach;
+    }), candidates.end());
+
+    candidatesValid = true;
+    cacheCenter = point;
+    cacheRadius = radius;
+    cacheVersion = document.version();
+    memoValid = false;
+}
+
+void SnapManager::updateSettings(float newSnapThreshold, float newZoom)
 {
     snapThreshold = std::max(newSnapThreshold, 1.0f);  // Ensure minimum threshold
     zoom = std::max(newZoom, 0.1f);  // Prevent zero or negative zoom
-    lines = newLines;  // Now can copy since lines is not const reference
     
     // Reset to clean state
     currentSnapType = SNAP_NONE;
@@ -122,6 +263,149 @@ void SnapManager::updateSettings(float newSnapThreshold, float newZoom, const st
     currentSnapPoint = QVector2D(0, 0);
 }
 
+void SnapManager::syncWithDocument()
+{
+    if (syncedVersion == document.version()) return;
+
+    if (!document.changesSince(syncedVersion, changes)) {
+        linesReset();
+        changes.clear();
+    }
+
+    // The hooks read the current lines, so added/modified indices are only
+    // meaningful once no later removal has shifted them. Snapping syncs on
+    // every mouse move, so a removal after other edits is rare; just rebuild.
+    bool sawEdit = false;
+    for (const DocumentChange* change : changes) {
+        if (change->type == DocumentChange::LinesRemoved && sawEdit) {
+            linesReset();
+            changes.clear();
+            break;
+        }
+        if (change->type != DocumentChange::LinesRemoved) {
+            sawEdit = true;
+        }
+    }
+
+    for (const DocumentChange* change : changes) {
+        switch (change->type) {
+            case DocumentChange::LinesAdded:
+                for (const auto& range : change->ranges) {
+                    linesAdded(range.first, range.second - range.first);
+                }
+                break;
+            case DocumentChange::LinesModified: {
+                // Colour-only edits leave the indices untouched
+                if (!change->geometryChanged) break;
+                std::vector<int> indices;
+                for (const auto& range : change->ranges) {
+                    for (size_t i = range.first; i < range.second; ++i) {
+                        indices.push_back(static_cast<int>(i));
+                    }
+                }
+                linesChanged(indices);
+                break;
+            }
+            case DocumentChange::LinesRemoved:
+                linesRemoved(change->removed);
+                break;
+            case DocumentChange::LinesReset:
+                linesReset();
+                break;
+        }
+    }
+    syncedVersion = document.version();
+}
+
+void SnapManager::ensureIndices(float effectiveThreshold)
+{
+    const LineStore& lines = document.lines();
+
+    // Cells follow the snap radius, rounded up to a power of two so zooming
+    // only rebuilds the grid when the radius crosses an octave
+    float cellSize = std::exp2(std::ceil(std::log2(std::max(effectiveThreshold, 1e-6f))));
+
+    if (!lineIndexValid || cellSize != lineIndex.cellSize() || lineIndex.size() != lines.size()) {
+        lineIndex.setCellSize(cellSize);
+        for (size_t i = 0; i < lines.size(); ++i) {
+            lineIndex.insert(static_cast<int>(i), lines.start(i), lines.end(i));
+        }
+        lineIndexValid = true;
+    }
+
+    // The crossings and the lines they were found with do not depend on the
+    // zoom; only the grid of crossing points follows the snap radius
+    if ((modes & SnapIntersection) == 0) {
+        return;
+    }
+    if (!intersectionsValid || intersections.lineCount() != lines.size()) {
+        intersections.build(lines, cellSize);
+        intersectionsValid = true;
+    } else if (cellSize != intersections.cellSize()) {
+        intersections.setCellSize(cellSize);
+    }
+}
+
+void SnapManager::linesAdded(size_t first, size_t count)
+{
+    if (!lineIndexValid) {
+        // Rebuilt on the next query anyway
+        linesReset();
+        return;
+    }
+
+    const LineStore& lines = document.lines();
+    std::vector<int> added;
+    for (size_t i = first; i < first + count && i < lines.size(); ++i) {
+        lineIndex.insert(static_cast<int>(i), lines.start(i), lines.end(i));
+        added.push_back(static_cast<int>(i));
+    }
+    if (intersectionsValid) {
+        intersections.insertLines(added, lines);
+    }
+}
+
+void SnapManager::linesChanged(const std::vector<int>& indices)
+{
+    if (!lineIndexValid) {
+        linesReset();
+        return;
+    }
+
+    const LineStore& lines = document.lines();
+    std::vector<int> changed;
+    for (int index : indices) {
+        if (index >= 0 && index < static_cast<int>(lines.size())) {
+            lineIndex.update(index, lines.start(index), lines.end(index));
+            changed.push_back(index);
+        }
+    }
+    if (intersectionsValid) {
+        intersections.removeLines(changed);
+        intersections.insertLines(changed, lines);
+    }
+}
+
+void SnapManager::linesRemoved(const std::vector<int>& sortedIndices)
+{
+    if (!lineIndexValid) {
+        linesReset();
+        return;
+    }
+
+    lineIndex.eraseAndCompact(sortedIndices);
+    if (intersectionsValid) {
+        intersections.eraseAndCompact(sortedIndices);
+    }
+}
+
+void SnapManager::linesReset()
+{
+    lineIndexValid = false;
+    intersectionsValid = false;
+    candidatesValid = false;
+}
+
 bool SnapManager::checkTempPoint(const QVector2D& point, const QVector2D& tempPoint, bool hasTempPoint)
 {
     if (!hasTempPoint) return false;
@@ -147,19 +431,24 @@ void SnapManager::drawSnapMarker(const QVector2D& /*pan*/, float zoom)
     if (!snapActive)
         return;
 
+    drawSnapMarker(currentSnapPoint, currentSnapType, zoom);
+}
+
+void SnapManager::drawSnapMarker(const QVector2D& point, SnapType type, float zoom)
+{
     float markerSize = 15.0f / zoom;  // Increased marker size
     
     glLineWidth(3.0f);  // Thicker lines for better visibility
 
-    switch (currentSnapType) {
+    switch (type) {
         case SNAP_ENDPOINT:
             // Draw square
             glColor3f(1.0f, 1.0f, 0.0f);  // Yellow
             glBegin(GL_LINE_LOOP);
-            glVertex2f(currentSnapPoint.x() - markerSize/2, currentSnapPoint.y() - markerSize/2);
-            glVertex2f(currentSnapPoint.x() + markerSize/2, currentSnapPoint.y() - markerSize/2);
-            glVertex2f(currentSnapPoint.x() + markerSize/2, currentSnapPoint.y() + markerSize/2);
-            glVertex2f(currentSnapPoint.x() - markerSize/2, currentSnapPoint.y() + markerSize/2);
+            glVertex2f(point.x() - markerSize/2, point.y() - markerSize/2);
+            glVertex2f(point.x() + markerSize/2, point.y() - markerSize/2);
+            glVertex2f(point.x() + markerSize/2, point.y() + markerSize/2);
+            glVertex2f(point.x() - markerSize/2, point.y() + markerSize/2);
             glEnd();
             break;
 
@@ -167,10 +456,10 @@ void SnapManager::drawSnapMarker(const QVector2D& /*pan*/, float zoom)
             // Draw diamond
             glColor3f(0.0f, 1.0f, 1.0f);  // Cyan
             glBegin(GL_LINE_LOOP);
-            glVertex2f(currentSnapPoint.x(), currentSnapPoint.y() - markerSize/2);
-            glVertex2f(currentSnapPoint.x() + markerSize/2, currentSnapPoint.y());
-            glVertex2f(currentSnapPoint.x(), currentSnapPoint.y() + markerSize/2);
-            glVertex2f(currentSnapPoint.x() - markerSize/2, currentSnapPoint.y());
+            glVertex2f(point.x(), point.y() - markerSize/2);
+            glVertex2f(point.x() + markerSize/2, point.y());
+            glVertex2f(point.x(), point.y() + markerSize/2);
+            glVertex2f(point.x() - markerSize/2, point.y());
             glEnd();
             break;
 
@@ -179,11 +468,26 @@ void SnapManager::drawSnapMarker(const QVector2D& /*pan*/, float zoom)
             glColor3f(1.0f, 0.0f, 1.0f);  // Magenta for intersections
             glBegin(GL_LINES);
             // First diagonal
-            glVertex2f(currentSnapPoint.x() - markerSize/2, currentSnapPoint.y() - markerSize/2);
-            glVertex2f(currentSnapPoint.x() + markerSize/2, currentSnapPoint.y() + markerSize/2);
+            glVertex2f(point.x() - markerSize/2, point.y() - markerSize/2);
+            glVertex2f(point.x() + markerSize/2, point.y() + markerSize/2);
             // Second diagonal
-            glVertex2f(currentSnapPoint.x() - markerSize/2, currentSnapPoint.y() + markerSize/2);
-            glVertex2f(currentSnapPoint.x() + markerSize/2, currentSnapPoint.y() - markerSize/2);
+            glVertex2f(point.x() - markerSize/2, point.y() + markerSize/2);
+            glVertex2f(point.x() + markerSize/2, point.y() - markerSize/2);
+            glEnd();
+            break;
+
+        case SNAP_PERPENDICULAR:
+            // Draw right-angle symbol
+            glColor3f(1.0f, 0.5f, 0.0f);  // Orange
+            glBegin(GL_LINE_STRIP);
+            glVertex2f(point.x() - markerSize/2, point.y() + markerSize/2);
+            glVertex2f(point.x() - markerSize/2, point.y() - markerSize/2);
+            glVertex2f(point.x() + markerSize/2, point.y() - markerSize/2);
+            glEnd();
+            glBegin(GL_LINE_STRIP);
+            glVertex2f(point.x() - markerSize/2, point.y());
+            glVertex2f(point.x(), point.y());
+            glVertex2f(point.x(), point.y() - markerSize/2);
             glEnd();
             break;
 
@@ -191,42 +495,13 @@ void SnapManager::drawSnapMarker(const QVector2D& /*pan*/, float zoom)
             // Draw cross-hair for line snaps
             glColor3f(0.0f, 1.0f, 0.0f);  // Green
             glBegin(GL_LINES);
-            glVertex2f(currentSnapPoint.x() - markerSize, currentSnapPoint.y());
-            glVertex2f(currentSnapPoint.x() + markerSize, currentSnapPoint.y());
-            glVertex2f(currentSnapPoint.x(), currentSnapPoint.y() - markerSize);
-            glVertex2f(currentSnapPoint.x(), currentSnapPoint.y() + markerSize);
+            glVertex2f(point.x() - markerSize, point.y());
+            glVertex2f(point.x() + markerSize, point.y());
+            glVertex2f(point.x(), point.y() - markerSize);
+            glVertex2f(point.x(), point.y() + markerSize);
             glEnd();
             break;
     }
 
     glLineWidth(1.0f);
 }
-
-// Add this helper function to find intersection points
-bool SnapManager::findIntersection(const Line& line1, const Line& line2, QVector2D& intersection)
-{
-    QVector2D p1 = line1.start;
-    QVector2D p2 = line1.end;
-    QVector2D p3 = line2.start;
-    QVector2D p4 = line2.end;
-
-    float x1 = p1.x(), y1 = p1.y();
-    float x2 = p2.x(), y2 = p2.y();
-    float x3 = p3.x(), y3 = p3.y();
-    float x4 = p4.x(), y4 = p4.y();
-
-    float denom = (x1 - x2) * (y3 - y4) - (y1 - y2) * (x3 - x4);
-    if (std::abs(denom) < 1e-6f)  // Lines are parallel
-        return false;
-
-    float t = ((x1 - x3) * (y3 - y4) - (y1 - y3) * (x3 - x4)) / denom;
-    float u = -((x1 - x2) * (y1 - y3) - (y1 - y2) * (x1 - x3)) / denom;
-
-    if (t >= 0 && t <= 1 && u >= 0 && u <= 1) {
-        intersection.setX(x1 + t * (x2 - x1));
-        intersection.setY(y1 + t * (y2 - y1));
-        return true;
-    }
-
-    return false;
-}
\ No newline at end of file
@@ -0,0 +1,195 @@
+#include "SnapWorker.h"
+#include <QMutexLocker>
+#include <algorithm>
+
+SnapWorker::SnapWorker(QObject* parent)
+    : QObject(parent)
+    , hasPending(false)
+    , stopRequested(false)
+    , forwardedVersion(0)
+    , postedSequence(0)
+    , snapManager(1.0f, 1.0f, replica)
+{
+    qRegisterMetaType<SnapResult>();
+}
+
+void SnapWorker::forwardChanges(const Document& document, std::vector<DocumentUpdate>& out)
+{
+    if (document.version() == forwardedVersion) return;
+
+    // Added and moved lines are shipped with their final geometry, which is
+    // only valid at their current indices if no removal came after them
+    bool full = !document.changesSince(forwardedVersion, changes);
+    std::vector<int> edited;
+    for (size_t c = 0; c < changes.size() && !full; ++c) {
+        const DocumentChange* change = changes[c];
+        switch (change->type) {
+            case DocumentChange::LinesAdded:
+            case DocumentChange::LinesModified:
+                // Colours do not matter for snapping
+                if (!change->geometryChanged) break;
+                for (const auto& range : change->ranges) {
+                    for (size_t i = range.first; i < range.second; ++i) {
+                        edited.push_back(static_cast<int>(i));
+                    }
+                }
+                break;
+            case DocumentChange::LinesRemoved:
+                if (!edited.empty()) {
+                    full = true;
+                    break;
+                }
+                out.push_back({DocumentUpdate::Remove, change->removed, {}});
+                break;
+            case DocumentChange::LinesReset:
+                full = true;
+                break;
+        }
+    }
+
+    if (full) {
+        out.clear();
+        out.push_back({DocumentUpdate::Reset, {}, document.lines()});
+    } else if (!edited.empty()) {
+        std::sort(edited.begin(), edited.end());
+        edited.erase(std::unique(edited.begin(), edited.end()), edited.end());
+
+        const LineStore& lines = document.lines();
+        DocumentUpdate update{DocumentUpdate::Assign, std::move(edited), {}};
+        update.lines.reserve(update.indices.size());
+        for (int index : update.indices) {
+            update.lines.push_back(lines.x0(index), lines.y0(index), lines.x1(index), lines.y1(index), lines.rgba(index));
+        }
+        out.push_back(std::move(update));
+    }
+    forwardedVersion = document.version();
+}
+
+quint64 SnapWorker::post(const Document& document, const SnapQuery& query, bool exact)
+{
+    // Copy the edited lines before taking the lock so the worker never
+    // waits on it
+    std::vector<DocumentUpdate> updates;
+    forwardChanges(document, updates);
+
+    QMutexLocker locker(&mutex);
+    for (DocumentUpdate& update : updates) {
+        pendingUpdates.push_back(std::move(update));
+    }
+    // Replaces any request the worker has not picked up yet
+    pending = {query, ++postedSequence, exact};
+    hasPending = true;
+    requestPosted.wakeOne();
+    return pending.sequence;
+}
+
+quint64 SnapWorker::requestSnap(const Document& document, const SnapQuery& query)
+{
+    return post(document, query, false);
+}
+
+SnapResult SnapWorker::snapNow(const Document& document, const SnapQuery& query)
+{
+    const quint64 sequence = post(document, query, true);
+
+    QMutexLocker locker(&mutex);
+    while (exactResult.sequence != sequence && !stopRequested) {
+        exactAnswered.wait(&mutex);
+    }
+    if (exactResult.sequence != sequence) {
+        // Stopped before answering; behave as if nothing was in reach
+        SnapResult result;
+        result.point = query.point;
+        result.sequence = sequence;
+        return result;
+    }
+    return exactResult;
+}
+
+void SnapWorker::stop()
+{
+    QMutexLocker locker(&mutex);
+    stopRequested = true;
+    requestPosted.wakeAll();
+    exactAnswered.wakeAll();
+}
+
+void SnapWorker::run()
+{
+    QMutexLocker locker(&mutex);
+    for (;;) {
+        while (!hasPending && !stopRequested) {
+            requestPosted.wait(&mutex);
+        }
+        if (stopRequested) break;
+
+        const Request request = pending;
+        hasPending = false;
+        std::vector<DocumentUpdate> updates;
+        updates.swap(pendingUpdates);
+        locker.unlock();
+
+        for (DocumentUpdate& update : updates) {
+            apply(update);
+        }
+        const SnapResult result = snap(request);
+
+        if (request.exact) {
+            locker.relock();
+            exactResult = result;
+            exactAnswered.wakeAll();
+        } else {
+            emit snapFound(result);
+            locker.relock();
+        }
+    }
+}
+
+void SnapWorker::apply(DocumentUpdate& update)
+{
+    switch (update.type) {
+        case DocumentUpdate::Reset:
+            replica.setLines(std::move(update.lines));
+            break;
+        case DocumentUpdate::Remove:
+            replica.eraseLines(update.indices);
+            break;
+        case DocumentUpdate::Assign: {
+            // Indices are ascending, so the appended lines form the tail
+            const auto tail = std::lower_bound(update.indices.begin(), update.indices.end(), static_cast<int>(replica.size()));
+            const size_t moved = static_cast<size_t>(tail - update.indices.begin());
+            if (moved > 0) {
+                replica.replaceGeometry(std::vector<int>(update.indices.begin(), tail), update.lines);
+            }
+            if (moved < update.indices.size()) {
+                LineStore added;
+                added.reserve(update.indices.size() - moved);
+                for (size_t k = moved; k < update.indices.size(); ++k) {
+                    added.push_back(update.lines.x0(k), update.lines.y0(k), update.lines.x1(k), update.lines.y1(k), update.lines.rgba(k));
+                }
+                replica.appendLines(added);
+            }
+            break;
+        }
+    }
+}
+
+SnapResult SnapWorker::snap(const Request& request)
+{
+    const SnapQuery& query = request.query;
+    snapManager.updateSettings(query.snapThreshold, query.zoom);
+    snapManager.setSnapModes(query.modes);
+    if (query.hasReferencePoint) {
+        snapManager.setReferencePoint(query.referencePoint);
+    } else {
+        snapManager.clearReferencePoint();
+    }
+    snapManager.updateSnap(query.point);
+
+    SnapResult result;
+    result.active = snapManager.isSnapActive();
+    result.point = result.active ? snapManager.getCurrentSnapPoint() : query.point;
+    result.type = result.active ? snapManager.snapType() : SnapManager::SNAP_NONE;
+    result.sequence = request.sequence;
+    return result;
+}
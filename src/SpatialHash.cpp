@@ -0,0 +1,318 @@
+#include "SpatialHash.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// Keep cell coordinates well inside int range so keys never wrap
+const float maxCellCoord = 1.0e9f;
+
+} // namespace
+
+SpatialHash::SpatialHash(float cellSize)
+    : cellWidth(std::max(cellSize, std::numeric_limits<float>::min()))
+{
+}
+
+void SpatialHash::setCellSize(float newSize)
+{
+    cellWidth = std::max(newSize, std::numeric_limits<float>::min());
+    clear();
+}
+
+void SpatialHash::clear()
+{
+    levels.clear();
+    entries.clear();
+    visitStamps.clear();
+    currentStamp = 0;
+}
+
+int SpatialHash::cellCoord(float v, float width)
+{
+    float c = std::floor(v / width);
+    c = std::clamp(c, -maxCellCoord, maxCellCoord);
+    return static_cast<int>(c);
+}
+
+template <typename Visitor>
+void SpatialHash::forEachCell(const Entry& entry, float width, Visitor&& visit)
+{
+    // Grid traversal (Amanatides & Woo) visiting every cell the segment crosses
+    int cx = cellCoord(entry.x0, width);
+    int cy = cellCoord(entry.y0, width);
+    const int ex = cellCoord(entry.x1, width);
+    const int ey = cellCoord(entry.y1, width);
+
+    const float dx = entry.x1 - entry.x0;
+    const float dy = entry.y1 - entry.y0;
+    const int stepX = dx > 0.0f ? 1 : -1;
+    const int stepY = dy > 0.0f ? 1 : -1;
+    const float inf = std::numeric_limits<float>::infinity();
+
+    float tMaxX = inf, tDeltaX = inf;
+    if (dx != 0.0f) {
+        float boundary = (cx + (stepX > 0 ? 1 : 0)) * width;
+        tMaxX = (boundary - entry.x0) / dx;
+        tDeltaX = width / std::abs(dx);
+    }
+    float tMaxY = inf, tDeltaY = inf;
+    if (dy != 0.0f) {
+        float boundary = (cy + (stepY > 0 ? 1 : 0)) * width;
+        tMaxY = (boundary - entry.y0) / dy;
+        tDeltaY = width / std::abs(dy);
+    }
+
+    visit(cx, cy);
+    while (cx != ex || cy != ey) {
+        // Never overshoot the end cell on an axis because of rounding
+        bool stepAlongX = (cy == ey) || (cx != ex && tMaxX < tMaxY);
+        if (stepAlongX) {
+            cx += stepX;
+            tMaxX += tDeltaX;
+        } else {
+            cy += stepY;
+            tMaxY += tDeltaY;
+        }
+        visit(cx, cy);
+    }
+}
+
+long long SpatialHash::cellSpan(const Entry& entry, float width)
+{
+    // Number of cells the traversal visits: one per boundary crossed plus the first
+    return std::llabs(static_cast<long long>(cellCoord(entry.x1, width)) - cellCoord(entry.x0, width))
+         + std::llabs(static_cast<long long>(cellCoord(entry.y1, width)) - cellCoord(entry.y0, width)) + 1;
+}
+
+int SpatialHash::levelFor(const Entry& entry) const
+{
+    float width = cellWidth;
+    for (int level = 0; level < maxLevels - 1; ++level, width *= 2.0f) {
+        if (cellSpan(entry, width) <= maxCellsPerSegment) {
+            return level;
+        }
+    }
+    return maxLevels - 1;
+}
+
+SpatialHash::Level& SpatialHash::levelAt(int level)
+{
+    while (static_cast<int>(levels.size()) <= level) {
+        levels.push_back({std::ldexp(cellWidth, static_cast<int>(levels.size())), {}});
+    }
+    return levels[level];
+}
+
+void SpatialHash::insert(int id, const QVector2D& start, const QVector2D& end)
+{
+    if (id < 0) return;
+    if (static_cast<size_t>(id) >= entries.size()) {
+        entries.resize(id + 1);
+    }
+
+    if (entries[id].inserted) {
+        remove(id);
+    }
+    Entry& entry = entries[id];
+    entry.x0 = start.x();
+    entry.y0 = start.y();
+    entry.x1 = end.x();
+    entry.y1 = end.y();
+    entry.inserted = true;
+    entry.level = levelFor(entry);
+
+    Level& level = levelAt(entry.level);
+    forEachCell(entry, level.width, [&](int cx, int cy) {
+        level.cells[cellKey(cx, cy)].push_back(id);
+    });
+}
+
+void SpatialHash::remove(int id)
+{
+    if (id < 0 || static_cast<size_t>(id) >= entries.size()) return;
+
+    Entry& entry = entries[id];
+    if (!entry.inserted) return;
+    entry.inserted = false;
+
+    Level& level = levels[entry.level];
+    forEachCell(entry, level.width, [&](int cx, int cy) {
+        auto it = level.cells.find(cellKey(cx, cy));
+        if (it == level.cells.end()) return;
+
+        std::vector<int>& ids = it->second;
+        auto pos = std::find(ids.begin(), ids.end(), id);
+        if (pos != ids.end()) {
+            *pos = ids.back();
+            ids.pop_back();
+        }
+        if (ids.empty()) {
+            level.cells.erase(it);
+        }
+    });
+}
+
+void SpatialHash::update(int id, const QVector2D& start, const QVector2D& end)
+{
+    remove(id);
+    insert(id, start, end);
+}
+
+void SpatialHash::eraseAndCompact(const std::vector<int>& sortedIds)
+{
+    if (sortedIds.empty()) return;
+
+    for (int id : sortedIds) {
+        remove(id);
+    }
+
+    // Every surviving id shifts down by the number of removed ids below it
+    auto renumber = [&](int id) {
+        return id - static_cast<int>(std::lower_bound(sortedIds.begin(), sortedIds.end(), id) - sortedIds.begin());
+    };
+
+    for (Level& level : levels) {
+        for (auto& cell : level.cells) {
+            for (int& id : cell.second) {
+                id = renumber(id);
+            }
+        }
+    }
+
+    size_t write = 0;
+    size_t next = 0;
+    for (size_t read = 0; read < entries.size(); ++read) {
+        if (next < sortedIds.size() && static_cast<size_t>(sortedIds[next]) == read) {
+            ++next;
+            continue;
+        }
+        entries[write++] = entries[read];
+    }
+    entries.resize(write);
+}
+
+void SpatialHash::beginQuery() const
+{
+    if (visitStamps.size() < entries.size()) {
+        visitStamps.resize(entries.size(), 0);
+    }
+    if (++currentStamp == 0) {
+        // Stamp counter wrapped; start over so stale stamps cannot match
+        std::fill(visitStamps.begin(), visitStamps.end(), 0);
+        currentStamp = 1;
+    }
+}
+
+void SpatialHash::query(const QVector2D& center, float radius, std::vector<int>& out) const
+{
+    out.clear();
+    if (entries.empty()) return;
+
+    beginQuery();
+
+    auto visitCell = [&](const std::vector<int>& ids) {
+        for (int id : ids) {
+            if (visitStamps[id] != currentStamp) {
+                visitStamps[id] = currentStamp;
+                out.push_back(id);
+            }
+        }
+    };
+
+    for (const Level& level : levels) {
+        if (level.cells.empty()) continue;
+
+        const int minX = cellCoord(center.x() - radius, level.width);
+        const int maxX = cellCoord(center.x() + radius, level.width);
+        const int minY = cellCoord(center.y() - radius, level.width);
+        const int maxY = cellCoord(center.y() + radius, level.width);
+
+        const double queryCells = (static_cast<double>(maxX) - minX + 1.0) * (static_cast<double>(maxY) - minY + 1.0);
+        if (queryCells > static_cast<double>(level.cells.size())) {
+            // Radius is large compared to the cells; walking the occupied cells is cheaper
+            for (const auto& cell : level.cells) {
+                const int cx = static_cast<int>(static_cast<uint32_t>(cell.first >> 32));
+                const int cy = static_cast<int>(static_cast<uint32_t>(cell.first));
+                if (cx >= minX && cx <= maxX && cy >= minY && cy <= maxY) {
+                    visitCell(cell.second);
+                }
+            }
+        } else {
+            for (int cx = minX; cx <= maxX; ++cx) {
+                for (int cy = minY; cy <= maxY; ++cy) {
+                    auto it = level.cells.find(cellKey(cx, cy));
+                    if (it != level.cells.end()) {
+                        visitCell(it->second);
+                    }
+                }
+            }
+        }
+    }
+
+    std::sort(out.begin(), out.end());
+}
+
+void SpatialHash::querySegment(const QVector2D& start, const QVector2D& end, std::vector<int>& out) const
+{
+    out.clear();
+    if (entries.empty()) return;
+
+    Entry probe;
+    probe.x0 = start.x();
+    probe.y0 = start.y();
+    probe.x1 = end.x();
+    probe.y1 = end.y();
+
+    beginQuery();
+
+    auto visitCell = [&](const std::vector<int>& ids) {
+        for (int id : ids) {
+            if (visitStamps[id] != currentStamp) {
+                visitStamps[id] = currentStamp;
+                out.push_back(id);
+            }
+        }
+    };
+
+    for (const Level& level : levels) {
+        if (level.cells.empty()) continue;
+
+        if (cellSpan(probe, level.width) <= static_cast<long long>(level.cells.size())) {
+            forEachCell(probe, level.width, [&](int cx, int cy) {
+                auto it = level.cells.find(cellKey(cx, cy));
+                if (it != level.cells.end()) {
+                    visitCell(it->second);
+                }
+            });
+            continue;
+        }
+
+        // The probe crosses more cells than this level has occupied; test
+        // each occupied cell against the probe instead. The cell is padded
+        // slightly so rounding never drops a cell the traversal would visit.
+        const float minX = std::min(probe.x0, probe.x1), maxX = std::max(probe.x0, probe.x1);
+        const float minY = std::min(probe.y0, probe.y1), maxY = std::max(probe.y0, probe.y1);
+        const float dx = probe.x1 - probe.x0;
+        const float dy = probe.y1 - probe.y0;
+        const float pad = level.width * 1.0e-3f;
+        for (const auto& cell : level.cells) {
+            const int cx = static_cast<int>(static_cast<uint32_t>(cell.first >> 32));
+            const int cy = static_cast<int>(static_cast<uint32_t>(cell.first));
+            const float left = cx * level.width - pad, right = (cx + 1) * level.width + pad;
+            const float bottom = cy * level.width - pad, top = (cy + 1) * level.width + pad;
+            if (right < minX || left > maxX || top < minY || bottom > maxY) continue;
+
+            // Separating axis along the probe's normal: all four corners on one side
+            auto side = [&](float x, float y) { return dx * (y - probe.y0) - dy * (x - probe.x0); };
+            const float a = side(left, bottom), b = side(right, bottom);
+            const float c = side(left, top), d = side(right, top);
+            if ((a > 0 && b > 0 && c > 0 && d > 0) || (a < 0 && b < 0 && c < 0 && d < 0)) continue;
+
+            visitCell(cell.second);
+        }
+    }
+
+    std::sort(out.begin(), out.end());
+}
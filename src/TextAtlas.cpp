@@ -0,0 +1,287 @@
+#include "TextAtlas.h"
+#include <QFontMetrics>
+#include <QPainter>
+#include <cmath>
+#include <cstddef>
+
+namespace {
+
+// Each label's anchor is snapped to a pixel and the quads have whole-pixel
+// offsets, so glyphs are copied from the atlas texel for texel
+const char* textVertexShader = R"(
+#version 120
+uniform vec2 viewport;
+uniform vec2 atlasSize;
+attribute vec2 anchor;
+attribute vec2 offset;
+attribute vec2 texCoord;
+varying vec2 vTexCoord;
+void main()
+{
+    vec4 clip = gl_ModelViewProjectionMatrix * vec4(anchor, 0.0, 1.0);
+    vec2 pixel = floor((clip.xy / clip.w * 0.5 + 0.5) * viewport + 0.5);
+    gl_Position = vec4((pixel + offset) / viewport * 2.0 - 1.0, 0.0, 1.0);
+    vTexCoord = texCoord / atlasSize;
+}
+)";
+
+const char* textFragmentShader = R"(
+#version 120
+uniform sampler2D atlas;
+uniform vec4 color;
+varying vec2 vTexCoord;
+void main()
+{
+    gl_FragColor = vec4(color.rgb, color.a * texture2D(atlas, vTexCoord).a);
+}
+)";
+
+const int anchorAttribute = 0;
+const int offsetAttribute = 1;
+const int texCoordAttribute = 2;
+
+const int atlasWidth = 512;
+const int initialAtlasHeight = 128;
+const int glyphPadding = 1;  // Room for antialiasing and overhangs
+
+} // namespace
+
+TextAtlas::TextAtlas()
+    : pixelRatio(1.0)
+    , generation(0)
+    , initialized(false)
+    , shelfX(0)
+    , shelfY(0)
+    , lineHeight(0)
+    , ascent(0)
+    , atlasDirty(false)
+    , atlasTexture(0)
+    , vertexBuffer(QOpenGLBuffer::VertexBuffer)
+    , batchDirty(false)
+    , uploadedVertices(0)
+{
+}
+
+TextAtlas::~TextAtlas()
+{
+    // GL objects must be released through cleanup() while the context is current
+}
+
+void TextAtlas::initialize(const QFont& baseFont, qreal devicePixelRatio)
+{
+    if (initialized) {
+        cleanup();
+    }
+    initializeOpenGLFunctions();
+
+    // Glyphs are rasterised at device resolution
+    font = baseFont;
+    if (baseFont.pixelSize() > 0) {
+        font.setPixelSize(qRound(baseFont.pixelSize() * devicePixelRatio));
+    } else {
+        font.setPointSizeF(baseFont.pointSizeF() * devicePixelRatio);
+    }
+    pixelRatio = devicePixelRatio;
+    ++generation;
+
+    atlas = QImage(atlasWidth, initialAtlasHeight, QImage::Format_RGBA8888_Premultiplied);
+    atlas.fill(Qt::transparent);
+    glyphs.clear();
+    QFontMetrics metrics(font, &atlas);
+    lineHeight = metrics.height() + 2 * glyphPadding;
+    ascent = metrics.ascent() + glyphPadding;
+    shelfX = 0;
+    shelfY = 0;
+    atlasDirty = true;
+    textureSize = QSize();
+
+    program.addShaderFromSourceCode(QOpenGLShader::Vertex, textVertexShader);
+    program.addShaderFromSourceCode(QOpenGLShader::Fragment, textFragmentShader);
+    program.bindAttributeLocation("anchor", anchorAttribute);
+    program.bindAttributeLocation("offset", offsetAttribute);
+    program.bindAttributeLocation("texCoord", texCoordAttribute);
+    if (!program.link()) {
+        return;
+    }
+
+    glGenTextures(1, &atlasTexture);
+    glBindTexture(GL_TEXTURE_2D, atlasTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    vertexBuffer.create();
+    vertexBuffer.setUsagePattern(QOpenGLBuffer::StaticDraw);
+
+    batch.clear();
+    batchDirty = true;
+    uploadedVertices = 0;
+    initialized = true;
+}
+
+void TextAtlas::cleanup()
+{
+    if (atlasTexture != 0) {
+        glDeleteTextures(1, &atlasTexture);
+        atlasTexture = 0;
+    }
+    vertexBuffer.destroy();
+    program.removeAllShaders();
+    initialized = false;
+}
+
+const TextAtlas::Glyph& TextAtlas::glyph(QChar character)
+{
+    auto found = glyphs.constFind(character);
+    if (found != glyphs.constEnd()) {
+        return *found;
+    }
+
+    QFontMetrics metrics(font, &atlas);
+    const int advance = metrics.horizontalAdvance(character);
+    const int width = advance + 2 * glyphPadding;
+
+    if (shelfX + width > atlas.width()) {
+        shelfX = 0;
+        shelfY += lineHeight;
+    }
+    if (shelfY + lineHeight > atlas.height()) {
+        // Grow downwards; glyph coordinates stay valid
+        QImage grown(atlas.width(), atlas.height() * 2, atlas.format());
+        grown.fill(Qt::transparent);
+        QPainter copier(&grown);
+        copier.setCompositionMode(QPainter::CompositionMode_Source);
+        copier.drawImage(0, 0, atlas);
+        copier.end();
+        atlas = grown;
+    }
+
+    QPainter painter(&atlas);
+    painter.setFont(font);
+    painter.setPen(Qt::white);
+    painter.setRenderHint(QPainter::TextAntialiasing);
+    painter.drawText(QPointF(shelfX + glyphPadding, shelfY + ascent), QString(character));
+    painter.end();
+
+    Glyph entry;
+    entry.u0 = static_cast<float>(shelfX);
+    entry.v0 = static_cast<float>(shelfY);
+    entry.u1 = static_cast<float>(shelfX + width);
+    entry.v1 = static_cast<float>(shelfY + lineHeight);
+    entry.advance = static_cast<float>(advance);
+    shelfX += width;
+    atlasDirty = true;
+
+    return *glyphs.insert(character, entry);
+}
+
+void TextAtlas::layout(const QString& text, TextLayout& out)
+{
+    out.quads.clear();
+    out.atlasGeneration = generation;
+
+    float width = 0.0f;
+    for (QChar character : text) {
+        width += glyph(character).advance;
+    }
+
+    // Whole-pixel offsets, centred like Qt::AlignCenter would
+    float pen = -std::floor(width / 2.0f);
+    const float top = std::floor(lineHeight / 2.0f);
+    const float bottom = top - lineHeight;
+    for (QChar character : text) {
+        const Glyph g = glyph(character);
+        if (!character.isSpace()) {
+            const float x0 = pen - glyphPadding;
+            out.quads.push_back({x0, bottom, x0 + (g.u1 - g.u0), top, g.u0, g.v1, g.u1, g.v0});
+        }
+        pen += g.advance;
+    }
+}
+
+void TextAtlas::clear()
+{
+    batch.clear();
+    batchDirty = true;
+}
+
+void TextAtlas::addText(const QVector2D& anchor, const TextLayout& layout)
+{
+    for (const TextLayout::Quad& quad : layout.quads) {
+        const Vertex bottomLeft = {anchor.x(), anchor.y(), quad.x0, quad.y0, quad.u0, quad.v0};
+        const Vertex bottomRight = {anchor.x(), anchor.y(), quad.x1, quad.y0, quad.u1, quad.v0};
+        const Vertex topRight = {anchor.x(), anchor.y(), quad.x1, quad.y1, quad.u1, quad.v1};
+        const Vertex topLeft = {anchor.x(), anchor.y(), quad.x0, quad.y1, quad.u0, quad.v1};
+        batch.insert(batch.end(), {bottomLeft, bottomRight, topRight, bottomLeft, topRight, topLeft});
+    }
+    batchDirty = true;
+}
+
+void TextAtlas::setupAttributes()
+{
+    glEnableVertexAttribArray(anchorAttribute);
+    glVertexAttribPointer(anchorAttribute, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+                          reinterpret_cast<const void*>(offsetof(Vertex, anchorX)));
+    glEnableVertexAttribArray(offsetAttribute);
+    glVertexAttribPointer(offsetAttribute, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+                          reinterpret_cast<const void*>(offsetof(Vertex, offsetX)));
+    glEnableVertexAttribArray(texCoordAttribute);
+    glVertexAttribPointer(texCoordAttribute, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+                          reinterpret_cast<const void*>(offsetof(Vertex, u)));
+}
+
+void TextAtlas::draw(const QSize& viewport, const QColor& color)
+{
+    if (!initialized) return;
+
+    if (atlasDirty) {
+        glBindTexture(GL_TEXTURE_2D, atlasTexture);
+        if (textureSize != atlas.size()) {
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, atlas.width(), atlas.height(), 0,
+                         GL_RGBA, GL_UNSIGNED_BYTE, atlas.constBits());
+            textureSize = atlas.size();
+        } else {
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, atlas.width(), atlas.height(),
+                            GL_RGBA, GL_UNSIGNED_BYTE, atlas.constBits());
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+        atlasDirty = false;
+    }
+
+    if (batchDirty) {
+        vertexBuffer.bind();
+        vertexBuffer.allocate(batch.data(), static_cast<int>(batch.size() * sizeof(Vertex)));
+        vertexBuffer.release();
+        uploadedVertices = batch.size();
+        batchDirty = false;
+    }
+    if (uploadedVertices == 0) return;
+
+    const bool blending = glIsEnabled(GL_BLEND);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    program.bind();
+    program.setUniformValue("viewport", static_cast<GLfloat>(viewport.width()), static_cast<GLfloat>(viewport.height()));
+    program.setUniformValue("atlasSize", static_cast<GLfloat>(textureSize.width()), static_cast<GLfloat>(textureSize.height()));
+    program.setUniformValue("color", color);
+    program.setUniformValue("atlas", 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, atlasTexture);
+
+    vertexBuffer.bind();
+    setupAttributes();
+    glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(uploadedVertices));
+    glDisableVertexAttribArray(anchorAttribute);
+    glDisableVertexAttribArray(offsetAttribute);
+    glDisableVertexAttribArray(texCoordAttribute);
+    vertexBuffer.release();
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    program.release();
+    if (!blending) {
+        glDisable(GL_BLEND);
+    }
+}
@@ -0,0 +1,401 @@
+#include "Topology.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Hash cells span this many tolerances, so most lookups touch one cell.
+// Exact welding (zero tolerance) still needs a usable cell size.
+const float cellsPerTolerance = 16.0f;
+const float minimumCellWidth = 1e-3f;
+
+} // namespace
+
+Topology::Topology(const Document& document, float tolerance)
+    : document(document)
+    , weldTolerance(std::max(tolerance, 0.0f))
+    , cellWidth(std::max(weldTolerance * cellsPerTolerance, minimumCellWidth))
+    , syncedVersion(0)
+    , tableValid(false)
+{
+}
+
+void Topology::setTolerance(float tolerance)
+{
+    tolerance = std::max(tolerance, 0.0f);
+    if (tolerance == weldTolerance) return;
+    weldTolerance = tolerance;
+    cellWidth = std::max(weldTolerance * cellsPerTolerance, minimumCellWidth);
+    clear();
+}
+
+void Topology::clear()
+{
+    // Swap with empty containers so the memory is actually released
+    std::vector<Vertex>().swap(vertices);
+    std::vector<int>().swap(freeVertices);
+    std::unordered_map<uint64_t, int>().swap(cells);
+    std::vector<int>().swap(endVertices);
+    std::vector<int>().swap(nextEnds);
+    staleLines.clear();
+    tableValid = false;
+}
+
+size_t Topology::vertexCount()
+{
+    syncWithDocument();
+    return vertices.size() - freeVertices.size();
+}
+
+QVector2D Topology::vertexPosition(int vertex)
+{
+    syncWithDocument();
+    return vertices[vertex].point;
+}
+
+int Topology::startVertex(int line)
+{
+    syncWithDocument();
+    return endVertices[2 * line];
+}
+
+int Topology::endVertex(int line)
+{
+    syncWithDocument();
+    return endVertices[2 * line + 1];
+}
+
+void Topology::linesAt(int vertex, std::vector<int>& out)
+{
+    syncWithDocument();
+    out.clear();
+    for (int end = vertices[vertex].firstEnd; end >= 0; end = nextEnds[end]) {
+        // A line with both ends here is listed through its start only
+        if ((end & 1) && endVertices[end - 1] == vertex) continue;
+        out.push_back(end >> 1);
+    }
+}
+
+int Topology::findVertex(const QVector2D& point)
+{
+    syncWithDocument();
+    return nearestInCells(point);
+}
+
+QVector2D Topology::weld(const QVector2D& point)
+{
+    const int vertex = findVertex(point);
+    return vertex >= 0 ? vertices[vertex].point : point;
+}
+
+void Topology::weldLines(LineStore& lines)
+{
+    syncWithDocument();
+
+    // Points of the batch that did not weld to a vertex, chained by cell
+    // like the vertices, so the lines after them can weld to them
+    struct AddedPoint {
+        QVector2D point;
+        int next;
+    };
+    std::vector<AddedPoint> added;
+    std::unordered_map<uint64_t, int> addedCells;
+    addedCells.reserve(lines.size());
+    const float toleranceSquared = weldTolerance * weldTolerance;
+    auto weldPoint = [&](const QVector2D& point) {
+        const int vertex = nearestInCells(point);
+        if (vertex >= 0) return vertices[vertex].point;
+
+        int best = -1;
+        float bestDistance = toleranceSquared;
+        forEachNearbyCell(point, [&](uint64_t key) {
+            auto head = addedCells.find(key);
+            if (head == addedCells.end()) return;
+            for (int other = head->second; other >= 0; other = added[other].next) {
+                const float distance = (added[other].point - point).lengthSquared();
+                if (distance <= bestDistance && (best < 0 || distance < bestDistance || other < best)) {
+                    best = other;
+                    bestDistance = distance;
+                }
+            }
+        });
+        if (best >= 0) return added[best].point;
+
+        int& head = addedCells.try_emplace(pointKey(point), -1).first->second;
+        added.push_back({point, head});
+        head = static_cast<int>(added.size() - 1);
+        return point;
+    };
+
+    for (size_t i = 0; i < lines.size(); ++i) {
+        const QVector2D start = weldPoint(lines.start(i));
+        const QVector2D end = weldPoint(lines.end(i));
+        if (start != lines.start(i) || end != lines.end(i)) {
+            lines.setGeometry(i, start.x(), start.y(), end.x(), end.y());
+        }
+    }
+}
+
+void Topology::connectedLines(const std::vector<int>& lines, std::vector<int>& out)
+{
+    syncWithDocument();
+    out.clear();
+
+    const size_t lineCount = endVertices.size() / 2;
+    visited.assign(lineCount, 0);
+    pending.clear();
+    for (int line : lines) {
+        if (line >= 0 && static_cast<size_t>(line) < lineCount && !visited[line]) {
+            visited[line] = 1;
+            pending.push_back(line);
+        }
+    }
+
+    while (!pending.empty()) {
+        const int line = pending.back();
+        pending.pop_back();
+        out.push_back(line);
+        for (int end = 2 * line; end <= 2 * line + 1; ++end) {
+            const int vertex = endVertices[end];
+            if (vertex < 0) continue;
+            for (int other = vertices[vertex].firstEnd; other >= 0; other = nextEnds[other]) {
+                if (!visited[other >> 1]) {
+                    visited[other >> 1] = 1;
+                    pending.push_back(other >> 1);
+                }
+            }
+        }
+    }
+    std::sort(out.begin(), out.end());
+}
+
+void Topology::syncWithDocument()
+{
+    if (tableValid && syncedVersion == document.version()) return;
+
+    if (tableValid && !document.changesSince(syncedVersion, changes)) {
+        tableValid = false;
+    }
+
+    // Lines are attached with their current geometry, which later edits in
+    // the batch may have moved or shifted; collect them and attach once the
+    // whole batch is replayed
+    for (size_t c = 0; c < changes.size() && tableValid; ++c) {
+        const DocumentChange* change = changes[c];
+        switch (change->type) {
+            case DocumentChange::LinesAdded:
+                for (const auto& range : change->ranges) {
+                    endVertices.resize(2 * range.second, -1);
+                    nextEnds.resize(2 * range.second, -1);
+                    for (size_t i = range.first; i < range.second; ++i) {
+                        staleLines.push_back(static_cast<int>(i));
+                    }
+                }
+                break;
+            case DocumentChange::LinesModified:
+                // Colour-only edits leave the vertices untouched
+                if (!change->geometryChanged) break;
+                for (const auto& range : change->ranges) {
+                    for (size_t i = range.first; i < range.second; ++i) {
+                        detach(static_cast<int>(2 * i));
+                        detach(static_cast<int>(2 * i + 1));
+                        staleLines.push_back(static_cast<int>(i));
+                    }
+                }
+                break;
+            case DocumentChange::LinesRemoved: {
+                // Rehashing everything beats unlinking a large share
+                const std::vector<int>& removed = change->removed;
+                if (removed.size() > endVertices.size() / 8) {
+                    tableValid = false;
+                    break;
+                }
+                for (int line : removed) {
+                    detach(2 * line);
+                    detach(2 * line + 1);
+                }
+                eraseAndCompact(removed);
+                size_t write = 0;
+                for (int line : staleLines) {
+                    auto it = std::lower_bound(removed.begin(), removed.end(), line);
+                    if (it != removed.end() && *it == line) continue;
+                    staleLines[write++] = line - static_cast<int>(it - removed.begin());
+                }
+                staleLines.resize(write);
+                break;
+            }
+            case DocumentChange::LinesReset:
+                tableValid = false;
+                break;
+        }
+    }
+    changes.clear();
+
+    if (!tableValid) {
+        rebuild();
+    } else if (!staleLines.empty()) {
+        std::sort(staleLines.begin(), staleLines.end());
+        staleLines.erase(std::unique(staleLines.begin(), staleLines.end()), staleLines.end());
+        const LineStore& lines = document.lines();
+        for (int line : staleLines) {
+            if (static_cast<size_t>(line) < lines.size() && endVertices[2 * line] < 0) {
+                attach(2 * line, lines.start(line));
+                attach(2 * line + 1, lines.end(line));
+            }
+        }
+    }
+    staleLines.clear();
+    syncedVersion = document.version();
+}
+
+void Topology::rebuild()
+{
+    clear();
+    const LineStore& lines = document.lines();
+    endVertices.assign(2 * lines.size(), -1);
+    nextEnds.assign(2 * lines.size(), -1);
+    // Connected drawings have about one vertex per line
+    cells.reserve(lines.size());
+    for (size_t i = 0; i < lines.size(); ++i) {
+        attach(static_cast<int>(2 * i), lines.start(i));
+        attach(static_cast<int>(2 * i + 1), lines.end(i));
+    }
+    tableValid = true;
+}
+
+void Topology::attach(int end, const QVector2D& point)
+{
+    int vertex = nearestInCells(point);
+    if (vertex < 0) {
+        const uint64_t key = pointKey(point);
+        auto head = cells.find(key);
+        const Vertex created{point, -1, head != cells.end() ? head->second : -1};
+        if (!freeVertices.empty()) {
+            vertex = freeVertices.back();
+            freeVertices.pop_back();
+            vertices[vertex] = created;
+        } else {
+            vertex = static_cast<int>(vertices.size());
+            vertices.push_back(created);
+        }
+        cells[key] = vertex;
+    }
+
+    endVertices[end] = vertex;
+    nextEnds[end] = vertices[vertex].firstEnd;
+    vertices[vertex].firstEnd = end;
+}
+
+void Topology::detach(int end)
+{
+    const int vertex = endVertices[end];
+    if (vertex < 0) return;
+
+    int* link = &vertices[vertex].firstEnd;
+    while (*link != end) {
+        link = &nextEnds[*link];
+    }
+    *link = nextEnds[end];
+    endVertices[end] = -1;
+    nextEnds[end] = -1;
+
+    if (vertices[vertex].firstEnd < 0) {
+        unlinkFromCell(vertex);
+        freeVertices.push_back(vertex);
+    }
+}
+
+void Topology::eraseAndCompact(const std::vector<int>& sortedLines)
+{
+    // The removed lines are detached already; renumber the ends after them
+    auto renumber = [&](int end) {
+        const auto before = std::lower_bound(sortedLines.begin(), sortedLines.end(), end >> 1);
+        return end - 2 * static_cast<int>(before - sortedLines.begin());
+    };
+    for (Vertex& vertex : vertices) {
+        if (vertex.firstEnd >= 0) vertex.firstEnd = renumber(vertex.firstEnd);
+    }
+
+    const size_t lineCount = endVertices.size() / 2;
+    size_t write = 0;
+    size_t skip = 0;
+    for (size_t line = 0; line < lineCount; ++line) {
+        if (skip < sortedLines.size() && static_cast<size_t>(sortedLines[skip]) == line) {
+            ++skip;
+            continue;
+        }
+        for (size_t side = 0; side < 2; ++side) {
+            endVertices[2 * write + side] = endVertices[2 * line + side];
+            const int next = nextEnds[2 * line + side];
+            nextEnds[2 * write + side] = next >= 0 ? renumber(next) : -1;
+        }
+        ++write;
+    }
+    endVertices.resize(2 * write);
+    nextEnds.resize(2 * write);
+}
+
+int64_t Topology::cellCoord(double v) const
+{
+    // Cells are centred on multiples of their width, so round coordinates
+    // do not sit on cell borders. Clamped so far-off or NaN coordinates
+    // still map to some cell.
+    const double cell = std::floor(v / cellWidth + 0.5);
+    return static_cast<int64_t>(std::max(-4e18, std::min(4e18, cell)));
+}
+
+template <typename Visitor>
+void Topology::forEachNearbyCell(const QVector2D& point, Visitor&& visit) const
+{
+    // Cells are wider than the tolerance, so this is one to four cells
+    const int64_t x0 = cellCoord(static_cast<double>(point.x()) - weldTolerance);
+    const int64_t x1 = cellCoord(static_cast<double>(point.x()) + weldTolerance);
+    const int64_t y0 = cellCoord(static_cast<double>(point.y()) - weldTolerance);
+    const int64_t y1 = cellCoord(static_cast<double>(point.y()) + weldTolerance);
+    for (int64_t cx = x0; cx <= x1; ++cx) {
+        for (int64_t cy = y0; cy <= y1; ++cy) {
+            visit(cellKey(cx, cy));
+        }
+    }
+}
+
+int Topology::nearestInCells(const QVector2D& point) const
+{
+    const float toleranceSquared = weldTolerance * weldTolerance;
+    int best = -1;
+    float bestDistance = toleranceSquared;
+    forEachNearbyCell(point, [&](uint64_t key) {
+        auto head = cells.find(key);
+        if (head == cells.end()) return;
+        for (int vertex = head->second; vertex >= 0; vertex = vertices[vertex].nextInCell) {
+            const float distance = (vertices[vertex].point - point).lengthSquared();
+            if (distance <= bestDistance && (best < 0 || distance < bestDistance || vertex < best)) {
+                best = vertex;
+                bestDistance = distance;
+            }
+        }
+    });
+    return best;
+}
+
+void Topology::unlinkFromCell(int vertex)
+{
+    auto head = cells.find(pointKey(vertices[vertex].point));
+    if (head == cells.end()) return;
+
+    const int next = vertices[vertex].nextInCell;
+    if (head->second == vertex) {
+        if (next < 0) {
+            cells.erase(head);
+        } else {
+            head->second = next;
+        }
+        return;
+    }
+    for (int previous = head->second; previous >= 0; previous = vertices[previous].nextInCell) {
+        if (vertices[previous].nextInCell == vertex) {
+            vertices[previous].nextInCell = next;
+            return;
+        }
+    }
+}
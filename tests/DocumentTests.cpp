@@ -0,0 +1,79 @@
+#include <QVector2D>
+#include <random>
+#include <utility>
+#include <vector>
+#include "Document.h"
+#include "Testing.h"
+
+// Handles taken from random lines keep pointing at those lines through
+// appends and removals of others, go stale once their line is removed or
+// the document is reset, and asking again for a line's handle gives the
+// same one. Each line carries a unique id in its colour to tell them apart.
+TEST(handlesFollowTheirLines)
+{
+    std::mt19937 rng(17);
+    QRgb nextId = 1;
+    auto makeLine = [&]() {
+        return Line(QVector2D(0.0f, 0.0f), QVector2D(1.0f, 1.0f), QColor::fromRgba(nextId++));
+    };
+
+    Document document;
+    std::vector<std::pair<EntityHandle, QRgb>> held;  // Handle and the id of its line, 0 once stale
+
+    for (int step = 0; step < 5000; ++step) {
+        switch (rng() % 6) {
+        case 0: {
+            const QRgb id = nextId;
+            held.emplace_back(document.addLine(makeLine()), id);
+            break;
+        }
+        case 1: {
+            LineStore added;
+            for (int i = rng() % 50; i > 0; --i) added.push_back(makeLine());
+            document.appendLines(added);
+            break;
+        }
+        case 2: {
+            std::vector<int> indices;
+            for (size_t i = 0; i < document.size(); ++i) {
+                if (rng() % 10 == 0) indices.push_back(static_cast<int>(i));
+            }
+            for (auto& entry : held) {
+                int index = document.indexOf(entry.first);
+                for (int removed : indices) {
+                    if (removed == index) entry.second = 0;
+                }
+            }
+            document.eraseLines(indices);
+            break;
+        }
+        case 3:
+            if (rng() % 20 == 0) {
+                LineStore lines;
+                for (int i = rng() % 100; i > 0; --i) lines.push_back(makeLine());
+                document.setLines(lines);
+                for (auto& entry : held) entry.second = 0;
+            }
+            break;
+        default:
+            if (!document.empty()) {
+                size_t index = rng() % document.size();
+                EntityHandle handle = document.handleAt(index);
+                CHECK(handle == document.handleAt(index));
+                held.emplace_back(handle, document.lines().rgba(index));
+            }
+            break;
+        }
+
+        for (const auto& entry : held) {
+            int index = document.indexOf(entry.first);
+            if (entry.second == 0) {
+                CHECK(index == -1);
+            } else {
+                CHECK(index >= 0 && index < static_cast<int>(document.size()));
+                CHECK(index >= 0 && document.lines().rgba(index) == entry.second);
+            }
+        }
+    }
+    CHECK(document.indexOf(EntityHandle()) == -1);
+}
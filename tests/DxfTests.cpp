@@ -0,0 +1,195 @@
+#include <QDir>
+#include <QString>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+#include "DxfHandler.h"
+#include "LineStore.h"
+#include "Testing.h"
+
+namespace {
+
+// Entities for a drawing with the content that can pass for an entity
+// boundary: layer "0", a TEXT entity whose text is "0", and subclass
+// markers ("100" ends in a "0" and is followed by a name). Every LINE has
+// the same length in bytes, so shifting the whole section by one byte at a
+// time moves each chunk cut across every position within the lines.
+std::string makeEntities(size_t lineCount, const char* newline, LineStore& expected)
+{
+    std::mt19937 rng(11);
+    std::uniform_int_distribution<int> coordinate(-99999, 99999);
+
+    std::string out;
+    auto pair = [&](const char* code, const std::string& value) {
+        out += code;
+        out += newline;
+        out += value;
+        out += newline;
+    };
+    auto number = [](int value) {
+        char buffer[16];
+        std::snprintf(buffer, sizeof(buffer), "%6d", value);
+        return std::string(buffer);
+    };
+
+    for (size_t i = 0; i < lineCount; ++i) {
+        int x0 = coordinate(rng);
+        int y0 = coordinate(rng);
+        int x1 = coordinate(rng);
+        int y1 = coordinate(rng);
+        pair("0", "LINE");
+        pair("100", "AcDbEntity");
+        pair("8", "0");
+        pair(" 62", "1");  // Padded group code
+        pair("100", "AcDbLine");
+        pair(" 10", number(x0));
+        pair(" 20", number(y0));
+        pair(" 11", number(x1));
+        pair(" 21", number(y1));
+        pair("0", "TEXT");
+        pair("100", "AcDbEntity");
+        pair("8", "0");
+        pair("1", "0");
+        expected.push_back(x0, y0, x1, y1, QColor(Qt::red).rgba());
+    }
+    return out;
+}
+
+// The entities wrapped in a HEADER and an ENTITIES section, which the loader
+// cuts into chunks, or bare, which it parses as one chunk. 'padding'
+// characters of text in a leading entity shift everything after it.
+std::string makeDxf(const std::string& entities, const char* newline, size_t padding, bool sections)
+{
+    std::string out;
+    auto pair = [&](const char* code, const std::string& value) {
+        out += code;
+        out += newline;
+        out += value;
+        out += newline;
+    };
+
+    if (sections) {
+        pair("0", "SECTION");
+        pair("2", "HEADER");
+        pair("0", "ENDSEC");
+        pair("0", "SECTION");
+        pair("2", "ENTITIES");
+    }
+    pair("0", "TEXT");
+    pair("1", std::string(padding, 'x'));
+    out += entities;
+    if (sections) {
+        pair("0", "ENDSEC");
+        pair("0", "EOF");
+    }
+    return out;
+}
+
+struct LoadResult {
+    bool ok = false;
+    LineStore lines;
+    int batches = 0;
+};
+
+LoadResult load(const std::string& contents)
+{
+    const QString filename = QDir::tempPath() + "/ogltests_chunks.dxf";
+    {
+        std::ofstream file(filename.toStdString(), std::ios::binary);
+        file.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+    }
+
+    LoadResult result;
+    DxfLoadCallbacks callbacks;
+    callbacks.batch = [&](LineStore& batch, qint64, qint64) {
+        result.lines.append(batch);
+        ++result.batches;
+        return true;
+    };
+    result.ok = DxfHandler::loadDxf(filename, callbacks);
+    std::remove(filename.toStdString().c_str());
+    return result;
+}
+
+bool sameLines(const LineStore& a, const LineStore& b)
+{
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a.x0(i) != b.x0(i) || a.y0(i) != b.y0(i) || a.x1(i) != b.x1(i) || a.y1(i) != b.y1(i) ||
+            a.rgba(i) != b.rgba(i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+// A file just over one chunk long is cut once; with the section shifted a
+// byte at a time the cut lands on every position within an entity, and
+// every cut must give the same lines as parsing the entities in one piece
+TEST(dxfChunksMatchSinglePass)
+{
+    for (const char* newline : {"\n", "\r\n"}) {
+        LineStore expected;
+        const std::string entities = makeEntities(12000, newline, expected);
+        const size_t period = entities.size() / 12000;
+
+        const LoadResult single = load(makeDxf(entities, newline, 0, false));
+        CHECK(single.ok);
+        CHECK(single.batches == 1);
+        CHECK(sameLines(single.lines, expected));
+
+        for (size_t padding = 0; padding < period; ++padding) {
+            const LoadResult chunked = load(makeDxf(entities, newline, padding, true));
+            CHECK(chunked.ok);
+            CHECK(chunked.batches > 2);  // The header is a chunk of its own
+            CHECK(sameLines(chunked.lines, expected));
+        }
+    }
+}
+
+// A multi-megabyte drawing arrives in several batches, in file order, with
+// the progress growing to the file size; cancelling stops the load
+TEST(dxfLoadStreamsBatches)
+{
+    std::mt19937 rng(13);
+    std::uniform_real_distribution<float> position(-1e5f, 1e5f);
+    LineStore lines;
+    for (int i = 0; i < 200000; ++i) {
+        lines.push_back(position(rng), position(rng), position(rng), position(rng), QColor(Qt::white).rgba());
+    }
+    const QString filename = QDir::tempPath() + "/ogltests_batches.dxf";
+    CHECK(DxfHandler::saveDxf(filename, lines, -1));
+
+    LineStore loaded;
+    int batches = 0;
+    qint64 lastDone = 0;
+    qint64 fileSize = 0;
+    bool progressGrows = true;
+    DxfLoadCallbacks callbacks;
+    callbacks.batch = [&](LineStore& batch, qint64 bytesDone, qint64 bytesTotal) {
+        loaded.append(batch);
+        ++batches;
+        progressGrows = progressGrows && bytesDone > lastDone && bytesDone <= bytesTotal;
+        lastDone = bytesDone;
+        fileSize = bytesTotal;
+        return true;
+    };
+    DxfLoadStats stats;
+    CHECK(DxfHandler::loadDxf(filename, callbacks, &stats));
+    CHECK(fileSize > 4 << 20);
+    CHECK(batches > 4);
+    CHECK(progressGrows);
+    CHECK(lastDone == fileSize);
+    CHECK(stats.entities == lines.size());
+    CHECK(sameLines(loaded, lines));
+
+    int cancelledBatches = 0;
+    callbacks.batch = [&](LineStore&, qint64, qint64) { return ++cancelledBatches < 2; };
+    CHECK(!DxfHandler::loadDxf(filename, callbacks));
+    CHECK(cancelledBatches == 2);
+
+    std::remove(filename.toStdString().c_str());
+}
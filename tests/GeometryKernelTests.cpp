@@ -0,0 +1,147 @@
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "GeometryKernels.h"
+#include "LineStore.h"
+#include "Testing.h"
+
+using namespace GeometryKernels;
+
+namespace {
+
+// Extra slots past 'count' that no kernel may write
+const size_t guardSlots = 9;
+const unsigned char sentinel = 0xA5;
+
+// Every output of every kernel for one candidate list, as raw bytes
+struct Outputs {
+    std::vector<float> distance;
+    std::vector<float> t, x, y;
+    std::vector<float> start, end, mid;
+    std::vector<unsigned char> crossing;
+    std::vector<unsigned char> overlap;
+
+    explicit Outputs(size_t count)
+    {
+        for (std::vector<float>* column : {&distance, &t, &x, &y, &start, &end, &mid}) {
+            column->resize(count + guardSlots);
+            std::memset(column->data(), sentinel, column->size() * sizeof(float));
+        }
+        crossing.assign(count + guardSlots, sentinel);
+        overlap.assign(count + guardSlots, sentinel);
+    }
+
+    bool operator==(const Outputs& other) const
+    {
+        // Byte comparison, so NaN results must match bit for bit as well
+        auto same = [](const auto& a, const auto& b) {
+            return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(a[0])) == 0;
+        };
+        return same(distance, other.distance) && same(t, other.t) && same(x, other.x) && same(y, other.y) &&
+               same(start, other.start) && same(end, other.end) && same(mid, other.mid) &&
+               same(crossing, other.crossing) && same(overlap, other.overlap);
+    }
+};
+
+// Random lines with some of each degenerate shape: zero length,
+// horizontal and vertical on integer coordinates, and repeated copies
+LineStore randomLines(std::mt19937& rng, size_t count)
+{
+    std::uniform_real_distribution<float> coord(-100.0f, 100.0f);
+    LineStore lines;
+    for (size_t i = 0; i < count; ++i) {
+        float x0 = coord(rng), y0 = coord(rng), x1 = coord(rng), y1 = coord(rng);
+        switch (rng() % 8) {
+        case 0:
+            x1 = x0;
+            y1 = y0;
+            break;
+        case 1:
+            x0 = std::round(x0);
+            x1 = std::round(x1);
+            y0 = y1 = std::round(y0);
+            break;
+        case 2:
+            y0 = std::round(y0);
+            y1 = std::round(y1);
+            x0 = x1 = std::round(x0);
+            break;
+        case 3:
+            if (i > 0) {
+                x0 = lines.x0(i - 1);
+                y0 = lines.y0(i - 1);
+                x1 = lines.x1(i - 1);
+                y1 = lines.y1(i - 1);
+            }
+            break;
+        default:
+            break;
+        }
+        lines.push_back(x0, y0, x1, y1, 0xffffffff);
+    }
+    return lines;
+}
+
+void runKernels(const Segments& segments, const std::vector<int>& ids, const std::vector<int>& others,
+                float px, float py, const float rect[4], Outputs& out)
+{
+    const size_t count = ids.size();
+    distanceSquared(segments, ids.data(), count, px, py, out.distance.data());
+    project(segments, ids.data(), count, px, py, 1e-6f, out.t.data(), out.x.data(), out.y.data());
+    pointDistances(segments, ids.data(), count, px, py, out.start.data(), out.end.data(), out.mid.data());
+    intersectPairs(segments, ids.data(), others.data(), count, out.crossing.data());
+    overlapsRect(segments, ids.data(), count, rect[0], rect[1], rect[2], rect[3], out.overlap.data());
+}
+
+} // namespace
+
+// Every kernel gives byte-identical results under each instruction set the
+// CPU supports, for candidate counts around and between the vector widths
+// (so the scalar tails run too) and for segments of zero length. Query
+// points sometimes sit exactly on a segment end.
+TEST(kernelsMatchAcrossInstructionSets)
+{
+    std::mt19937 rng(29);
+    const LineStore lines = randomLines(rng, 4000);
+    const Segments segments = columns(lines);
+    const InstructionSet sets[] = {InstructionSet::Sse2, InstructionSet::Avx2};
+
+    std::uniform_real_distribution<float> coord(-120.0f, 120.0f);
+    std::uniform_int_distribution<int> pickLine(0, static_cast<int>(lines.size()) - 1);
+
+    for (int round = 0; round < 200; ++round) {
+        const size_t count = round < 40 ? static_cast<size_t>(round) : static_cast<size_t>(rng() % 600);
+        std::vector<int> ids(count), others(count);
+        for (size_t k = 0; k < count; ++k) {
+            ids[k] = pickLine(rng);
+            others[k] = pickLine(rng);
+        }
+
+        float px = coord(rng), py = coord(rng);
+        if (rng() % 4 == 0) {
+            const int line = pickLine(rng);
+            px = lines.x1(line);
+            py = lines.y1(line);
+        }
+        float rect[4] = {coord(rng), coord(rng), coord(rng), coord(rng)};
+        if (rect[0] > rect[2]) std::swap(rect[0], rect[2]);
+        if (rect[1] > rect[3]) std::swap(rect[1], rect[3]);
+
+        setInstructionSet(InstructionSet::Scalar);
+        Outputs reference(count);
+        runKernels(segments, ids, others, px, py, rect, reference);
+
+        for (InstructionSet set : sets) {
+            setInstructionSet(set);
+            if (instructionSet() != set) continue;  // Not supported here
+
+            Outputs result(count);
+            runKernels(segments, ids, others, px, py, rect, result);
+            CHECK(result == reference);
+        }
+    }
+
+    // Back to the best supported set for the tests that follow
+    setInstructionSet(InstructionSet::Avx2);
+}
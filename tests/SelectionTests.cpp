@@ -0,0 +1,185 @@
+#include <QRectF>
+#include <QVector2D>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+#include "Document.h"
+#include "Selection.h"
+#include "Testing.h"
+
+namespace {
+
+// Reference versions of the queries: the linear scans Selection replaced
+
+int orientation(const QVector2D& a, const QVector2D& b, const QVector2D& c)
+{
+    double cross = (double(b.x()) - a.x()) * (double(c.y()) - a.y()) -
+                   (double(b.y()) - a.y()) * (double(c.x()) - a.x());
+    return cross > 0 ? 1 : (cross < 0 ? -1 : 0);
+}
+
+bool inBox(const QVector2D& a, const QVector2D& b, const QVector2D& p)
+{
+    return std::min(a.x(), b.x()) <= p.x() && p.x() <= std::max(a.x(), b.x()) &&
+           std::min(a.y(), b.y()) <= p.y() && p.y() <= std::max(a.y(), b.y());
+}
+
+// Closed segments: touching counts
+bool segmentsTouch(const QVector2D& p1, const QVector2D& p2, const QVector2D& q1, const QVector2D& q2)
+{
+    int o1 = orientation(p1, p2, q1);
+    int o2 = orientation(p1, p2, q2);
+    int o3 = orientation(q1, q2, p1);
+    int o4 = orientation(q1, q2, p2);
+    if (o1 * o2 < 0 && o3 * o4 < 0) return true;
+    return (o1 == 0 && inBox(p1, p2, q1)) || (o2 == 0 && inBox(p1, p2, q2)) ||
+           (o3 == 0 && inBox(q1, q2, p1)) || (o4 == 0 && inBox(q1, q2, p2));
+}
+
+int linearPick(const LineStore& lines, const QVector2D& point, float radius)
+{
+    for (size_t i = 0; i < lines.size(); ++i) {
+        QVector2D ab = lines.end(i) - lines.start(i);
+        float t = QVector2D::dotProduct(point - lines.start(i), ab) / ab.lengthSquared();
+        t = std::clamp(t, 0.0f, 1.0f);
+        if ((point - (lines.start(i) + ab * t)).length() <= radius) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+std::vector<int> linearSelect(const LineStore& lines, const QRectF& rect, bool crossing)
+{
+    const QVector2D corners[] = {
+        QVector2D(rect.left(), rect.top()), QVector2D(rect.right(), rect.top()),
+        QVector2D(rect.right(), rect.bottom()), QVector2D(rect.left(), rect.bottom())};
+
+    std::vector<int> result;
+    for (size_t i = 0; i < lines.size(); ++i) {
+        const QVector2D a = lines.start(i);
+        const QVector2D b = lines.end(i);
+        bool startInside = rect.contains(QPointF(a.x(), a.y()));
+        bool endInside = rect.contains(QPointF(b.x(), b.y()));
+        bool selected = startInside && endInside;
+        if (crossing && !selected) {
+            selected = startInside || endInside;
+            for (int edge = 0; edge < 4 && !selected; ++edge) {
+                selected = segmentsTouch(a, b, corners[edge], corners[(edge + 1) % 4]);
+            }
+        }
+        if (selected) result.push_back(static_cast<int>(i));
+    }
+    return result;
+}
+
+// Random lines, a quarter of them snapped to a coarse grid so shared
+// endpoints, zero-length lines and lines along rectangle edges turn up
+class LineGenerator
+{
+public:
+    explicit LineGenerator(unsigned seed) : rng(seed), position(0.0f, 1000.0f), offset(-60.0f, 60.0f), grid(0, 50) {}
+
+    Line next()
+    {
+        if (rng() % 4 == 0) {
+            QVector2D start = gridPoint();
+            QVector2D end = rng() % 5 == 0 ? start : start + QVector2D(grid(rng) % 3 * 20.0f, grid(rng) % 3 * 20.0f);
+            return Line(start, end, Qt::white);
+        }
+        QVector2D start(position(rng), position(rng));
+        return Line(start, start + QVector2D(offset(rng), offset(rng)), Qt::white);
+    }
+
+    QVector2D gridPoint() { return QVector2D(grid(rng) * 20.0f, grid(rng) * 20.0f); }
+
+    std::mt19937 rng;
+    std::uniform_real_distribution<float> position;
+    std::uniform_real_distribution<float> offset;
+    std::uniform_int_distribution<int> grid;
+};
+
+void randomEdit(Document& document, LineGenerator& generator)
+{
+    std::mt19937& rng = generator.rng;
+    std::vector<int> indices;
+    for (size_t i = 0; i < document.size(); ++i) {
+        if (rng() % 50 == 0) indices.push_back(static_cast<int>(i));
+    }
+
+    switch (rng() % 5) {
+    case 0:
+        document.addLine(generator.next());
+        break;
+    case 1: {
+        LineStore added;
+        for (int i = rng() % 100; i > 0; --i) added.push_back(generator.next());
+        document.appendLines(added);
+        break;
+    }
+    case 2:
+        document.moveLines(indices, QVector2D(generator.offset(rng), generator.offset(rng)));
+        break;
+    case 3:
+        document.eraseLines(indices);
+        break;
+    default:
+        if (rng() % 10 == 0) document.clear();
+        else document.setLinesColor(indices, Qt::red);
+        break;
+    }
+}
+
+} // namespace
+
+// The R-tree kept up to date through the change log answers like a tree
+// bulk-loaded from the current lines and like the linear scans
+TEST(selectionIncrementalMatchesRebuild)
+{
+    LineGenerator generator(7);
+    std::mt19937& rng = generator.rng;
+
+    for (int round = 0; round < 20; ++round) {
+        Document document;
+        Selection selection(document);
+
+        LineStore initial;
+        for (int i = rng() % 3000; i > 0; --i) initial.push_back(generator.next());
+        document.setLines(initial);
+
+        for (int step = 0; step < 40; ++step) {
+            for (int edits = rng() % 4; edits > 0; --edits) {
+                randomEdit(document, generator);
+            }
+
+            Selection rebuilt(document);
+            for (int query = 0; query < 10; ++query) {
+                QRectF rect;
+                if (rng() % 3 == 0) {
+                    QVector2D corner = generator.gridPoint();
+                    rect = QRectF(corner.x(), corner.y(), 200.0, 200.0);
+                } else {
+                    float x = generator.position(rng);
+                    float y = generator.position(rng);
+                    float height = rng() % 10 ? std::abs(generator.offset(rng)) * 3.0f : 0.0f;
+                    rect = QRectF(x, y, std::abs(generator.offset(rng)) * 3.0f, height);
+                }
+
+                for (bool crossing : {false, true}) {
+                    std::vector<int> incremental;
+                    std::vector<int> fresh;
+                    selection.selectInRect(rect, crossing, incremental);
+                    rebuilt.selectInRect(rect, crossing, fresh);
+                    CHECK(incremental == fresh);
+                    CHECK(incremental == linearSelect(document.lines(), rect, crossing));
+                }
+
+                QVector2D point = rng() % 3 == 0 ? generator.gridPoint()
+                                                 : QVector2D(generator.position(rng), generator.position(rng));
+                float radius = rng() % 3 ? 10.0f : std::abs(generator.offset(rng));
+                int picked = selection.pickLine(point, radius);
+                CHECK(picked == rebuilt.pickLine(point, radius));
+                CHECK(picked == linearPick(document.lines(), point, radius));
+            }
+        }
+    }
+}
@@ -0,0 +1,154 @@
+#include <QColor>
+#include <QVector2D>
+#include <cmath>
+#include <limits>
+#include <random>
+#include "Document.h"
+#include "SnapManager.h"
+#include "Testing.h"
+
+namespace {
+
+bool crossingPoint(const QVector2D& a, const QVector2D& b, const QVector2D& c, const QVector2D& d, QVector2D& out)
+{
+    QVector2D r = b - a;
+    QVector2D s = d - c;
+    float denominator = r.x() * s.y() - r.y() * s.x();
+    if (std::fabs(denominator) < 1e-10f) return false;
+
+    QVector2D q = c - a;
+    float t = (q.x() * s.y() - q.y() * s.x()) / denominator;
+    float u = (q.x() * r.y() - q.y() * r.x()) / denominator;
+    if (t < 0 || t > 1 || u < 0 || u > 1) return false;
+    out = a + r * t;
+    return true;
+}
+
+struct SnapResult {
+    bool active = false;
+    SnapManager::SnapType type = SnapManager::SNAP_NONE;
+    QVector2D point;
+};
+
+// Every pass over every line and pair of lines, each skipped when its mode
+// is off; the specialised kernels must agree with this for any mode set
+SnapResult referenceSnap(const LineStore& lines, unsigned modes, const QVector2D& point, float threshold,
+                         const QVector2D* referencePoint)
+{
+    SnapResult result;
+    result.point = point;
+    float best = std::numeric_limits<float>::max();
+    auto consider = [&](const QVector2D& candidate, SnapManager::SnapType type) {
+        float distance = (point - candidate).length();
+        if (distance < threshold && distance < best) {
+            best = distance;
+            result = {true, type, candidate};
+        }
+    };
+    // Parameter of the projection of 'from' onto line i, or -1 for degenerate lines
+    auto project = [&](size_t i, const QVector2D& from, QVector2D& foot) {
+        QVector2D direction = lines.end(i) - lines.start(i);
+        float lengthSquared = direction.lengthSquared();
+        if (lengthSquared <= 1e-6f) return -1.0f;
+        float t = QVector2D::dotProduct(from - lines.start(i), direction) / lengthSquared;
+        foot = lines.start(i) + direction * t;
+        return t;
+    };
+
+    if (modes & SnapManager::SnapEndpoint) {
+        for (size_t i = 0; i < lines.size(); ++i) {
+            consider(lines.start(i), SnapManager::SNAP_ENDPOINT);
+            consider(lines.end(i), SnapManager::SNAP_ENDPOINT);
+        }
+    }
+    if ((modes & SnapManager::SnapIntersection) && !result.active) {
+        for (size_t i = 0; i < lines.size(); ++i) {
+            for (size_t j = i + 1; j < lines.size(); ++j) {
+                QVector2D crossing;
+                if (crossingPoint(lines.start(i), lines.end(i), lines.start(j), lines.end(j), crossing)) {
+                    consider(crossing, SnapManager::SNAP_INTERSECTION);
+                }
+            }
+        }
+    }
+    if ((modes & SnapManager::SnapMidpoint) && !result.active) {
+        for (size_t i = 0; i < lines.size(); ++i) {
+            consider((lines.start(i) + lines.end(i)) * 0.5f, SnapManager::SNAP_MIDPOINT);
+        }
+    }
+    if ((modes & SnapManager::SnapPerpendicular) && !result.active && referencePoint) {
+        for (size_t i = 0; i < lines.size(); ++i) {
+            QVector2D foot;
+            float t = project(i, *referencePoint, foot);
+            if (t > 0.0f && t < 1.0f) consider(foot, SnapManager::SNAP_PERPENDICULAR);
+        }
+    }
+    if ((modes & SnapManager::SnapNearest) && !result.active) {
+        for (size_t i = 0; i < lines.size(); ++i) {
+            QVector2D foot;
+            float t = project(i, point, foot);
+            if (t > 0.0f && t < 1.0f) consider(foot, SnapManager::SNAP_LINE);
+        }
+    }
+    return result;
+}
+
+} // namespace
+
+// Random mode sets, reference points, zoom levels and edits; after each
+// change the kernel picked for the current modes must snap to the same
+// point as the reference
+TEST(snapModesMatchReference)
+{
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<float> position(0.0f, 300.0f);
+    std::uniform_real_distribution<float> offset(-30.0f, 30.0f);
+
+    Document document;
+    LineStore initial;
+    for (int i = 0; i < 300; ++i) {
+        float x = position(rng);
+        float y = position(rng);
+        initial.push_back(x, y, x + offset(rng), y + offset(rng), 0xffffffffu);
+    }
+    document.setLines(initial);
+
+    const float snapThreshold = 5.0f;
+    SnapManager snapManager(snapThreshold, 1.0f, document);
+    int snapsByType[SnapManager::SNAP_LINE + 1] = {};
+
+    for (int step = 0; step < 5000; ++step) {
+        if (rng() % 50 == 0) snapManager.setSnapModes(rng() % (SnapManager::AllSnapModes + 1));
+        if (rng() % 40 == 0) {
+            document.moveLines({static_cast<int>(rng() % document.size())}, QVector2D(offset(rng), offset(rng)) * 0.1f);
+        }
+        if (rng() % 60 == 0) {
+            document.addLine(Line(QVector2D(position(rng), position(rng)), QVector2D(position(rng), position(rng)),
+                                  QColor(Qt::white)));
+        }
+        if (rng() % 80 == 0 && document.size() > 10) {
+            document.eraseLines({static_cast<int>(rng() % document.size())});
+        }
+
+        const bool hasReference = rng() % 2;
+        const QVector2D reference(position(rng), position(rng));
+        if (hasReference) snapManager.setReferencePoint(reference);
+        else snapManager.clearReferencePoint();
+
+        const QVector2D cursor(position(rng), position(rng));
+        const float zoom = rng() % 2 ? 1.0f : 0.5f;
+        snapManager.updateSettings(snapThreshold, zoom);
+        snapManager.updateSnap(cursor);
+
+        // The snap radius is five times the threshold, in world units
+        const SnapResult expected = referenceSnap(document.lines(), snapManager.snapModes(), cursor,
+                                                  snapThreshold * 5.0f / zoom, hasReference ? &reference : nullptr);
+        ++snapsByType[expected.type];
+        CHECK(snapManager.isSnapActive() == expected.active);
+        CHECK(snapManager.snapType() == expected.type);
+        CHECK(!expected.active || (snapManager.getCurrentSnapPoint() - expected.point).length() <= 1e-3f);
+    }
+
+    // Every pass got exercised
+    for (int count : snapsByType) CHECK(count > 0);
+}
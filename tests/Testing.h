@@ -0,0 +1,35 @@
+#ifndef TESTING_H
+#define TESTING_H
+
+#include <vector>
+
+// Just enough of a harness for the randomized checks: tests register
+// themselves by name, and CHECK records a failure and carries on so one
+// run reports every mismatch.
+namespace Testing {
+
+struct TestCase {
+    const char* name;
+    void (*run)();
+};
+
+std::vector<TestCase>& registry();
+void fail(const char* file, int line, const char* expression);
+
+struct Registrar {
+    Registrar(const char* name, void (*run)()) { registry().push_back({name, run}); }
+};
+
+} // namespace Testing
+
+#define TEST(name) \
+    static void name(); \
+    static Testing::Registrar name##Registrar(#name, name); \
+    static void name()
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) Testing::fail(__FILE__, __LINE__, #condition); \
+    } while (0)
+
+#endif // TESTING_H
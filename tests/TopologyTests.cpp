@@ -0,0 +1,170 @@
+#include <QVector2D>
+#include <algorithm>
+#include <map>
+#include <numeric>
+#include <random>
+#include <utility>
+#include <vector>
+#include "Document.h"
+#include "Testing.h"
+#include "Topology.h"
+
+namespace {
+
+// Lines between points of a coarse grid, so ends meet exactly and chains
+// of connected lines form, mixed with free lines that touch nothing and
+// the odd zero-length line
+class EndpointGenerator
+{
+public:
+    explicit EndpointGenerator(unsigned seed) : rng(seed), position(0.0f, 1000.0f), offset(-40.0f, 40.0f), grid(0, 30) {}
+
+    Line next()
+    {
+        if (rng() % 3 != 0) {
+            QVector2D start = gridPoint();
+            QVector2D end = rng() % 10 == 0 ? start : gridPoint();
+            return Line(start, end, Qt::white);
+        }
+        QVector2D start(position(rng), position(rng));
+        return Line(start, start + QVector2D(offset(rng), offset(rng)), Qt::white);
+    }
+
+    QVector2D gridPoint() { return QVector2D(grid(rng) * 25.0f, grid(rng) * 25.0f); }
+
+    std::mt19937 rng;
+    std::uniform_real_distribution<float> position;
+    std::uniform_real_distribution<float> offset;
+    std::uniform_int_distribution<int> grid;
+};
+
+void randomEdit(Document& document, EndpointGenerator& generator)
+{
+    std::mt19937& rng = generator.rng;
+    std::vector<int> indices;
+    for (size_t i = 0; i < document.size(); ++i) {
+        if (rng() % 40 == 0) indices.push_back(static_cast<int>(i));
+    }
+
+    switch (rng() % 5) {
+    case 0:
+        document.addLine(generator.next());
+        break;
+    case 1: {
+        LineStore added;
+        for (int i = rng() % 60; i > 0; --i) added.push_back(generator.next());
+        document.appendLines(added);
+        break;
+    }
+    case 2:
+        // Whole grid steps keep moved ends on the grid, so they can meet others
+        document.moveLines(indices, rng() % 2 ? QVector2D((rng() % 3) * 25.0f, (rng() % 3) * 25.0f)
+                                              : QVector2D(generator.offset(rng), generator.offset(rng)));
+        break;
+    case 3:
+        document.eraseLines(indices);
+        break;
+    default:
+        if (rng() % 15 == 0) document.clear();
+        else document.setLinesColor(indices, Qt::red);
+        break;
+    }
+}
+
+// Reference connectivity: union-find over lines whose ends are at exactly
+// the same position
+struct Components {
+    std::vector<int> parent;
+    size_t distinctPoints = 0;
+
+    explicit Components(const LineStore& lines) : parent(lines.size())
+    {
+        std::iota(parent.begin(), parent.end(), 0);
+        std::map<std::pair<float, float>, int> firstLineAt;
+        for (size_t i = 0; i < lines.size(); ++i) {
+            for (const QVector2D& point : {lines.start(i), lines.end(i)}) {
+                auto inserted = firstLineAt.emplace(std::make_pair(point.x(), point.y()), static_cast<int>(i));
+                if (!inserted.second) {
+                    parent[find(static_cast<int>(i))] = find(inserted.first->second);
+                }
+            }
+        }
+        distinctPoints = firstLineAt.size();
+    }
+
+    int find(int line)
+    {
+        while (parent[line] != line) {
+            parent[line] = parent[parent[line]];
+            line = parent[line];
+        }
+        return line;
+    }
+
+    std::vector<int> connected(const std::vector<int>& seeds)
+    {
+        std::vector<int> roots;
+        for (int seed : seeds) roots.push_back(find(seed));
+        std::vector<int> result;
+        for (size_t i = 0; i < parent.size(); ++i) {
+            if (std::find(roots.begin(), roots.end(), find(static_cast<int>(i))) != roots.end()) {
+                result.push_back(static_cast<int>(i));
+            }
+        }
+        return result;
+    }
+};
+
+} // namespace
+
+// The vertex table kept up to date through the change log matches one
+// built from the current lines: the same vertex count and positions for
+// every line end, and the same connected lines, which also match a
+// union-find over exactly coinciding ends
+TEST(topologyIncrementalMatchesRebuild)
+{
+    EndpointGenerator generator(11);
+    std::mt19937& rng = generator.rng;
+
+    for (int round = 0; round < 20; ++round) {
+        Document document;
+        Topology topology(document);
+
+        LineStore initial;
+        for (int i = rng() % 1500; i > 0; --i) initial.push_back(generator.next());
+        document.setLines(initial);
+
+        for (int step = 0; step < 40; ++step) {
+            for (int edits = rng() % 4; edits > 0; --edits) {
+                randomEdit(document, generator);
+            }
+
+            const LineStore& lines = document.lines();
+            Topology rebuilt(document);
+            Components reference(lines);
+
+            CHECK(topology.vertexCount() == rebuilt.vertexCount());
+            CHECK(topology.vertexCount() == reference.distinctPoints);
+
+            for (size_t i = 0; i < lines.size(); ++i) {
+                const int line = static_cast<int>(i);
+                CHECK(topology.vertexPosition(topology.startVertex(line)) == lines.start(i));
+                CHECK(topology.vertexPosition(topology.endVertex(line)) == lines.end(i));
+                CHECK(rebuilt.vertexPosition(rebuilt.startVertex(line)) == lines.start(i));
+                CHECK(rebuilt.vertexPosition(rebuilt.endVertex(line)) == lines.end(i));
+            }
+
+            for (int query = 0; query < 10 && !lines.empty(); ++query) {
+                std::vector<int> seeds;
+                for (int i = 1 + rng() % 3; i > 0; --i) seeds.push_back(static_cast<int>(rng() % lines.size()));
+
+                std::vector<int> incremental;
+                std::vector<int> fresh;
+                topology.connectedLines(seeds, incremental);
+                rebuilt.connectedLines(seeds, fresh);
+                CHECK(incremental == fresh);
+                CHECK(incremental == reference.connected(seeds));
+            }
+        }
+    }
+}
@@ -0,0 +1,61 @@
+#include <cstdio>
+#include <cstring>
+#include "Testing.h"
+
+namespace {
+
+// A randomized test that goes wrong tends to go wrong thousands of times
+const int maxReportedFailures = 10;
+
+int currentFailures = 0;
+
+} // namespace
+
+namespace Testing {
+
+std::vector<TestCase>& registry()
+{
+    static std::vector<TestCase> tests;
+    return tests;
+}
+
+void fail(const char* file, int line, const char* expression)
+{
+    if (++currentFailures <= maxReportedFailures) {
+        std::fprintf(stderr, "  %s:%d: CHECK(%s) failed\n", file, line, expression);
+    }
+}
+
+} // namespace Testing
+
+// Runs every test, or only the ones named on the command line. Exits
+// non-zero if any check failed.
+int main(int argc, char* argv[])
+{
+    int failedTests = 0;
+    int ranTests = 0;
+    for (const Testing::TestCase& test : Testing::registry()) {
+        bool selected = argc < 2;
+        for (int i = 1; i < argc && !selected; ++i) {
+            selected = std::strcmp(argv[i], test.name) == 0;
+        }
+        if (!selected) continue;
+
+        currentFailures = 0;
+        test.run();
+        ++ranTests;
+        if (currentFailures > 0) {
+            ++failedTests;
+            std::fprintf(stderr, "FAIL %s (%d failed checks)\n", test.name, currentFailures);
+        } else {
+            std::fprintf(stderr, "PASS %s\n", test.name);
+        }
+    }
+
+    if (ranTests == 0) {
+        std::fprintf(stderr, "No tests matched\n");
+        return 2;
+    }
+    std::fprintf(stderr, "%d of %d tests failed\n", failedTests, ranTests);
+    return failedTests > 0 ? 1 : 0;
+}
@@ -0,0 +1,61 @@
+QT       += core gui opengl
+CONFIG   += c++17 console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+TARGET = OGLTests
+
+# Randomized checks of the drawing core against reference implementations.
+# Run with no arguments for every test, or name the tests to run; exits
+# non-zero if any check fails.
+
+DESTDIR = $$PWD/../bin
+OBJECTS_DIR = $$PWD/../build/tests/obj
+MOC_DIR = $$PWD/../build/tests/moc
+
+# Include paths
+INCLUDEPATH += $$PWD/../include
+QT_INCLUDE_PATH = ../../../Qt/6.8.1/mingw_64
+INCLUDEPATH += $$QT_INCLUDE_PATH/include
+INCLUDEPATH += $$QT_INCLUDE_PATH/include/QtCore
+INCLUDEPATH += $$QT_INCLUDE_PATH/include/QtGui
+INCLUDEPATH += $$QT_INCLUDE_PATH/include/QtOpenGL
+
+# Library paths
+win32: LIBS += -L$$QT_INCLUDE_PATH/lib -lopengl32
+unix: LIBS += -lGL
+
+HEADERS += \
+    Testing.h \
+    ../include/SnapManager.h \
+    ../include/Line.h \
+    ../include/DxfHandler.h \
+    ../include/SpatialHash.h \
+    ../include/IntersectionIndex.h \
+    ../include/Document.h \
+    ../include/Selection.h \
+    ../include/RTree.h \
+    ../include/LineStore.h \
+    ../include/SlotMap.h \
+    ../include/GeometryKernels.h \
+    ../include/Topology.h
+
+SOURCES += \
+    main.cpp \
+    SelectionTests.cpp \
+    SnapTests.cpp \
+    DxfTests.cpp \
+    DocumentTests.cpp \
+    GeometryKernelTests.cpp \
+    TopologyTests.cpp \
+    ../src/SnapManager.cpp \
+    ../src/DxfHandler.cpp \
+    ../src/SpatialHash.cpp \
+    ../src/IntersectionIndex.cpp \
+    ../src/Document.cpp \
+    ../src/Selection.cpp \
+    ../src/RTree.cpp \
+    ../src/LineStore.cpp \
+    ../src/SlotMap.cpp \
+    ../src/GeometryKernels.cpp \
+    ../src/Topology.cpp